@@ -53,10 +53,19 @@ let connectValvesToPunches() =
     then Editor.writeLine "Routing aborted, because the number of unconnected punches is less than the number of unconnected control lines."
     else
     let chipGrid =  Routing.createChipGrid chip    
-    let mcfSolution = Routing.minCostFlowRouting chipGrid
+    let mcfSolution = Routing.incrementalMinCostFlowRouting chipGrid
     match mcfSolution with
     | None -> 
-        Editor.writeLine "Routing failed: try more relaxed settings, perhaps."
+        let cut = Routing.incrementalMinCostFlowRoutingCut chipGrid
+        if cut.Length = 0
+        then Editor.writeLine "Routing failed: try more relaxed settings, perhaps."
+        else
+        // the crosses mark the region the unrouted control lines are confined to
+        Editor.setColor 1 // Red
+        let grid = chipGrid :> Routing.IRoutingGrid
+        cut |> Array.iter (grid.ToPoint >> Debug.drawPoint BioStream.Micado.User.Settings.Current.Resolution)
+        Editor.resetColor()
+        Editor.writeLine (sprintf "Routing failed: the %d grid nodes marked in red have no free way out to the remaining punches; free their border, or try more relaxed settings." cut.Length)
     | Some mcfSolution -> 
         let iterativeSolver = new Routing.IterativeRouting (chipGrid, mcfSolution)
         let presenter = Routing.presentConnections chipGrid
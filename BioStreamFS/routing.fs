@@ -26,6 +26,20 @@ type IRoutingGrid =
     /// for all v & all w: w in v.Neighbors <=> v in w.InverseNeighbors
     abstract InverseNeighbors : int -> int seq
 
+/// A routing grid whose design rules only remove edges from a fixed topology,
+/// so that a routing network built once can follow design changes
+/// by closing and reopening the edges concerned.
+/// The first nX*nY nodes form a manhattan grid, numbered x+y*nX;
+/// the others are only connected through extra edges.
+/// The Neighbors of a node are its extra neighbors, in increasing order,
+/// followed by its grid neighbors (+x, +y, -x, -y) whose edge is not removed.
+type IDynamicRoutingGrid =
+    inherit IRoutingGrid
+    abstract GridSize : int * int
+    abstract ExtraEdges : Map<int, Set<int>>
+    /// the removed grid edges
+    abstract RemovedEdges : Map<int, Set<int>>
+
 let deltas = [1;-1]
 
 /// A simple grid
@@ -413,102 +427,215 @@ type ChipGrid ( chip : Chip ) =
     let inverseEdges = inverseMapSet edges
     let inverseRemovedEdges = inverseMapSet removedEdges
     let inverseNeighbors = computeNeighbors inverseEdges inverseRemovedEdges
-    interface IRoutingGrid with
+    interface IDynamicRoutingGrid with
         member v.NodeCount =  nodeCount
         member v.Neighbors index = neighbors index
         member v.ToPoint index = toPoint index
         member v.Sources with get() = Array.copy line2index
         member v.Targets with get() = Array.copy punch2index
         member v.InverseNeighbors index = inverseNeighbors index
+        member v.GridSize = (g.NX, g.NY)
+        member v.ExtraEdges = edges
+        member v.RemovedEdges = removedEdges
         
 let createChipGrid (chip : Chip) =
     new ChipGrid (chip)
     
+/// the grid direction (0: +x, 1: +y, 2: -x, 3: -y) of the edge between two grid nodes,
+/// if they are neighbors
+let gridDirection nX nY a b =
+    let x, y = a % nX, a / nX
+    let x', y' = b % nX, b / nX
+    match x'-x, y'-y with
+    | 1, 0 -> Some 0
+    | 0, 1 -> Some 1
+    | -1, 0 -> Some 2
+    | 0, -1 -> Some 3
+    | _ -> None
+
+/// builds the min cost flow network of the dynamic grid natively,
+/// reusing the buffers of the given network:
+/// each node of the grid is split into an incoming vertex and an outgoing vertex,
+/// linked by an edge of capacity 1, so that each node is used by at most one connection;
+/// each edge of the grid goes from the outgoing vertex of its source node
+/// to the incoming vertex of its target node, with capacity 1 and cost 1;
+/// a super source feeds the incoming vertices of the sources,
+/// and the outgoing vertices of the targets drain into a super target
+/// (see RoutingNetwork.h)
+let buildRoutingNetwork ( network : MgRoutingNetwork ) ( grid : #IDynamicRoutingGrid ) =
+    let nX, nY = grid.GridSize
+    let gridNodeCount = nX*nY
+    let nodeCount = grid.NodeCount
+    // the extra edges, in compressed rows: the heads of the extra edges of node v
+    // are extraHeads.[extraFirst.[v]..extraFirst.[v+1]-1]
+    let extraFirst = Array.create (nodeCount+1) 0
+    let extraHeads = new ResizeArray<int>()
+    grid.ExtraEdges |> Map.iter (fun node heads ->
+        heads |> Set.iter (fun head -> extraHeads.Add(head))
+        extraFirst.[node+1] <- extraHeads.Count)
+    for v in 1..nodeCount do
+        extraFirst.[v] <- max extraFirst.[v] extraFirst.[v-1]
+    // bit 4*v+d is set when the grid edge of node v in direction d is removed
+    let removed = new System.Collections.BitArray(4*gridNodeCount)
+    grid.RemovedEdges |> Map.iter (fun node neighbors ->
+        if node < gridNodeCount
+        then neighbors |> Set.iter (fun neighbor ->
+                 if neighbor < gridNodeCount
+                 then match gridDirection nX nY node neighbor with
+                      | Some d -> removed.[4*node+d] <- true
+                      | None -> ()))
+    let removedEdges = Array.zero_create ((4*gridNodeCount+31)/32) : int array
+    removed.CopyTo(removedEdges, 0)
+    network.Build(nX, nY, nodeCount-gridNodeCount, extraFirst, extraHeads.ToArray(), removedEdges, grid.Sources, grid.Targets)
+
+/// solves the routing network of a grid with the given number of nodes, loaded in the solver,
+/// and extracts the connection of each source from the solver
+let solveRoutingNetwork ( solver : MgMCFSolver ) nodeCount ( sources : int array ) =
+    solver.SolveMCF()
+    if not (solver.HasSolution())
+    then None
+    else
+    // each path starts from the outgoing vertex of its source,
+    // and alternates incoming and outgoing vertices until the super target
+    let path, offsets = solver.ExtractPaths(sources |> Array.map (fun (source) -> nodeCount + source + 1))
+    let traceConnection i =
+        // the source node is purposefully not part of the trace
+        // as it corresponds to a super node linking to all possible starting points for the source;
+        // the trace keeps the node of each incoming vertex, the last one first
+        let rec helper acc k =
+            if k = offsets.[i+1]
+            then acc
+            else let vertex = path.[k]
+                 helper (if vertex <= nodeCount then (vertex-1) :: acc else acc) (k+1)
+        helper [] offsets.[i]
+    Some (Array.init sources.Length traceConnection)
+
+/// when the last solve of the routing network of a grid with the given number of nodes failed,
+/// the grid nodes, in increasing order, of the unfeasible cut the solver stopped on:
+/// the region that the sources it could not route are confined to,
+/// with all its exits taken by other connections or cut off by removed edges,
+/// so that its border cells are the bottleneck to relieve;
+/// empty if the last solve did not fail
+let unfeasibleRoutingCut ( solver : MgMCFSolver ) nodeCount =
+    let _, vertices = solver.MCFGetUnfCut()
+    // the incoming and outgoing vertices of a node are both in the cut, or only one of them,
+    // and the super source and super target are not grid nodes
+    vertices
+    |> Array.filter (fun (vertex) -> vertex <= 2*nodeCount)
+    |> Array.map (fun (vertex) -> (vertex-1) % nodeCount)
+    |> Set.of_array
+    |> Set.to_array
+
+/// The min cost flow solver shared by all routing attempts,
+/// so that its native buffers are reused from one attempt to the next.
+/// Routing networks only have integer capacities, costs and deficits,
+/// so it uses the exact integer solver.
+let sharedSolver = lazy (new MgMCFSolver(MgMCFNumbers.Int32))
+
+/// Routes the grid with the given (reusable) min cost flow solver;
+/// the network is built natively, and its removed edges are loaded as closed arcs
+let minCostFlowRoutingWith ( solver : MgMCFSolver ) ( grid : #IDynamicRoutingGrid ) =
+    use network = new MgRoutingNetwork()
+    buildRoutingNetwork network grid
+    solver.Reload(network)
+    solveRoutingNetwork solver grid.NodeCount grid.Sources
+
 /// tries to find a routing solution,
 /// in which each source is routed to a target, 
 /// minimizing the total wiring length
 /// but not, notably, the number of vias,
 /// based on the paper
 /// Hua Xiang, Xiaoping Tang, and Martin D. F. Wong. Min-cost Flow Based Algorithm for Simultaneous Pin Assignment and Routing, IEEE Transactions on Computer-Aided Design of Integrated Circuits and Systems, Vol. 22, No. 7, pp 870-878, July, 2003. 
-let minCostFlowRouting ( grid : #IRoutingGrid ) =
-    let sources = grid.Sources
-    let targets = grid.Targets
-    let nodeCount = grid.NodeCount
-    // the indices of the vertices start at 1
-    let node2incomingVertex (node : int) =
-        uint32(node + 1) : uint32
-    let node2outgoingVertex (node : int) = 
-        uint32(nodeCount + node + 1) : uint32
-    let outgoingVertex2node (vertex : uint32) =
-        int(vertex) - nodeCount - 1
-    let incomingVertex2node (vertex : uint32) =
-        int(vertex) - 1
-    let addEdge source (outgoingEdges, (numberOfEdges, edge2source, edge2target, edge2capacity, edge2cost)) target =
-        (numberOfEdges :: outgoingEdges, 
-         (numberOfEdges+1, source :: edge2source, target :: edge2target, 1.0 :: edge2capacity, 1.0 :: edge2cost))
-    let addNode (node2outgoingEdges, acc) node =
-        let outgoingVertex = node2outgoingVertex node
-        let outgoingEdges, (numberOfEdges, edge2source, edge2target, edge2capacity, edge2cost) =
-            Seq.fold (addEdge outgoingVertex)
-                     ([], acc)
-                     ((grid.Neighbors node) |> Seq.map node2incomingVertex)
-        (outgoingEdges :: node2outgoingEdges, 
-         (numberOfEdges+1, (node2incomingVertex node) :: edge2source, outgoingVertex :: edge2target, 1.0 :: edge2capacity, 0.0 :: edge2cost))
-    let numberOfVertices = nodeCount*2 + 2
-    let super_source_vertex = uint32(numberOfVertices - 1)
-    let super_target_vertex = uint32(numberOfVertices)
-    let addSuperSourceEdges acc =
-        Seq.fold (fun (numberOfEdges, edge2source, edge2target, edge2capacity, edge2cost) source ->
-                    (numberOfEdges+1, super_source_vertex :: edge2source, source :: edge2target, 1.0 :: edge2capacity, 0.0 :: edge2cost))
-                 acc
-                 (sources |> Seq.map node2incomingVertex)
-    let addSuperTargetEdges (node2outgoingEdges : _ array) acc =  
-        Seq.fold (fun (numberOfEdges, edge2source, edge2target, edge2capacity, edge2cost) target ->
-                    node2outgoingEdges.[target] <- numberOfEdges :: node2outgoingEdges.[target]
-                    (numberOfEdges+1,  (node2outgoingVertex target) :: edge2source, super_target_vertex :: edge2target, 1.0 :: edge2capacity, 0.0 :: edge2cost))
-                 acc
-                 targets           
-    let node2outgoingEdges, acc =
-        Seq.fold addNode ([], (0, [], [], [], [])) {0..nodeCount-1}
-    let node2outgoingEdges = arrayOfRevList node2outgoingEdges
-    let acc = addSuperSourceEdges acc
-    let acc = addSuperTargetEdges node2outgoingEdges acc    
-    let numberOfEdges, edge2source, edge2target, edge2capacity, edge2cost = acc
-    let edge2source = arrayOfRevList edge2source
-    let edge2target = arrayOfRevList edge2target
-    let edge2capacity = arrayOfRevList edge2capacity
-    let edge2cost = arrayOfRevList edge2cost
-    let vertex2deficit = Array.create numberOfVertices 0.0
-    vertex2deficit.[int(super_source_vertex)-1] <- - float(sources.Length)
-    vertex2deficit.[int(super_target_vertex)-1] <- + float(sources.Length)
-    let traceConnection (x : _ array) sourceNode =
-        let rec helper acc outgoingVertex =
-            let node = outgoingVertex2node outgoingVertex
-            let edge = List.find (fun (edge) -> x.[edge] = 1.0) node2outgoingEdges.[node]
-            let incomingVertex' = edge2target.[edge]
-            if incomingVertex' = super_target_vertex
-            then acc
-            else let node' = incomingVertex' |> incomingVertex2node
-                 let outgoingVertex' =  node' |> node2outgoingVertex
-                 helper (node' :: acc) outgoingVertex'
-        // the source node is purposefully not part of the trace
-        // as it corresponds to a super node linking to all possible starting points for the source
-        helper [] (sourceNode |> node2outgoingVertex)
-    let traceAllConnections x =
-        Array.map (traceConnection x) sources
-    let findMinCostFlow() =
-        let solver = new MgMCFSolver(uint32(numberOfVertices), uint32(numberOfEdges), edge2capacity, edge2cost, vertex2deficit, edge2source, edge2target)
-        solver.SolveMCF();
-        if not (solver.HasSolution())
-        then None
-        else let x = Array.create numberOfEdges 0.0
-             solver.MCFGetX(x)
-             Some x
-    let solve() =
-        match findMinCostFlow() with
-        | None -> None
-        | Some x -> Some (traceAllConnections x)
-    solve()
+let minCostFlowRouting ( grid : #IDynamicRoutingGrid ) =
+    minCostFlowRoutingWith (sharedSolver.Force()) grid
+
+/// after minCostFlowRouting failed on the grid (returned None),
+/// the grid nodes of the bottleneck region, to be highlighted
+/// instead of retrying with relaxed constraints (see unfeasibleRoutingCut);
+/// after incrementalMinCostFlowRouting, see incrementalMinCostFlowRoutingCut
+let minCostFlowRoutingCut ( grid : #IRoutingGrid ) =
+    unfeasibleRoutingCut (sharedSolver.Force()) grid.NodeCount
+
+/// Min cost flow routing that keeps the network of the last routed grid in its solver.
+/// The network is built natively, into two alternating sets of buffers.
+/// When the next grid has the same topology, and only differs in its removed edges
+/// (e.g. an obstacle, a flow punch or a flow segment was placed or removed),
+/// only the edges concerned are closed or reopened, and the solve is incremental.
+/// Otherwise (e.g. an unconnected punch or control line was added, which adds a node),
+/// the network is reloaded.
+type IncrementalRouting ( solver : MgMCFSolver ) =
+    let mutable last : MgRoutingNetwork option = None
+    let mutable spare = new MgRoutingNetwork()
+    member v.Route ( grid : #IDynamicRoutingGrid ) =
+        let network = spare
+        buildRoutingNetwork network grid
+        match last with
+        | Some previous when previous.SameTopology(network) ->
+            solver.Update(previous, network)
+            spare <- previous
+        | Some previous ->
+            solver.Reload(network)
+            spare <- previous
+        | None ->
+            solver.Reload(network)
+            spare <- new MgRoutingNetwork()
+        last <- Some network
+        solveRoutingNetwork solver grid.NodeCount grid.Sources
+    /// after Route failed on the grid (returned None),
+    /// the grid nodes of the bottleneck region, from the solver that failed
+    /// (see unfeasibleRoutingCut)
+    member v.UnfeasibleCut ( grid : #IRoutingGrid ) =
+        unfeasibleRoutingCut solver grid.NodeCount
+
+/// The incremental routing shared by all chip grid routing attempts;
+/// it has a solver of its own, as it relies on its last network still being loaded
+let sharedIncrementalRouting = lazy (new IncrementalRouting(new MgMCFSolver(MgMCFNumbers.Int32)))
+
+/// like minCostFlowRouting, but only updates the removed edges
+/// since the previous routing of the same chip topology
+let incrementalMinCostFlowRouting ( grid : #IDynamicRoutingGrid ) =
+    sharedIncrementalRouting.Force().Route grid
+
+/// after incrementalMinCostFlowRouting failed on the grid (returned None),
+/// the grid nodes of the bottleneck region (see unfeasibleRoutingCut)
+let incrementalMinCostFlowRoutingCut ( grid : #IDynamicRoutingGrid ) =
+    sharedIncrementalRouting.Force().UnfeasibleCut grid
+
+/// Min cost flow routing of what-if variants of a base grid
+/// (e.g. the candidate placements of one more component).
+/// The base grid is routed once, and its solution is saved in the solver's format;
+/// each variant, which must have the same topology, is then routed starting from
+/// the base solution, rather than from the previous variant or from scratch.
+type BranchRouting ( solver : MgMCFSolver ) =
+    let baseNetwork = new MgRoutingNetwork()
+    let variant = new MgRoutingNetwork()
+    let mutable state : MgCS2State option = None
+    let mutable variantLoaded = false
+    /// routes the base grid, and saves its solution
+    member v.RouteBase ( grid : #IDynamicRoutingGrid ) =
+        buildRoutingNetwork baseNetwork grid
+        solver.Reload(baseNetwork)
+        variantLoaded <- false
+        let result = solveRoutingNetwork solver grid.NodeCount grid.Sources
+        match state with
+        | Some previous -> (previous :> System.IDisposable).Dispose()
+        | None -> ()
+        state <- Some (solver.GetState())
+        result
+    /// routes a variant of the base grid, from the solution of the base grid
+    member v.RouteVariant ( grid : #IDynamicRoutingGrid ) =
+        match state with
+        | None -> failwith "the base grid must be routed first"
+        | Some saved ->
+            // back to the base network and its solution, and only then to the variant
+            if variantLoaded
+            then solver.Update(variant, baseNetwork)
+                 variantLoaded <- false
+            solver.PutState(saved)
+            buildRoutingNetwork variant grid
+            solver.Update(baseNetwork, variant)
+            variantLoaded <- true
+            solveRoutingNetwork solver grid.NodeCount grid.Sources
 
 let segmentSlope (a : Point2d) (b : Point2d) =
     match a.X=b.X, a.Y=b.Y with
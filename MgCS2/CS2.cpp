@@ -39,8 +39,16 @@
 
 #include "CS2.h"
 
+#include "MappedFile.h"
+
 #include "OPTop.h"
 
+#include <string.h>
+
+#ifdef _OPENMP
+ #include <omp.h>
+#endif
+
 /*--------------------------------------------------------------------------*/
 /*-------------------------------- USING -----------------------------------*/
 /*--------------------------------------------------------------------------*/
@@ -85,35 +93,20 @@ using namespace MCFClass_di_unipi_it;
 /*--------------------------- CONSTANTS ------------------------------------*/
 /*--------------------------------------------------------------------------*/
 
-#if( Ctype == REAL_TYPE )
- static cCNumber PRICE_MIN              = - ( C_INF / 2 ) *
-                                            ( CNumber( 1 ) - C_em );
- static cCNumber LOW_BOUND              = 1.00001;
-#else
- static cCNumber PRICE_MIN              = - ( C_INF / 2 - 1 );
- static cCNumber LOW_BOUND              = 1;
-#endif
-
-static const double  UPDT_FREQ          = 0.4;
-static cIndex        UPDT_FREQ_S        = 30;
-static cCNumber      SCALE_DEFAULT      = 12;
-
-static const long    PRICE_OUT_START    = 10;  // may not be less than 1
-
-static const double  CUT_OFF_POWER      = 0.44;
-static const double  CUT_OFF_COEF       = 1.5;
-static const double  CUT_OFF_POWER2     = 0.75;
-static const double  CUT_OFF_COEF2      = 1;
-static const double  CUT_OFF_GAP        = 0.8;
-static const double  CUT_OFF_MIN        = 12;
-static const double  CUT_OFF_INCREASE   = 4;
-
-static const char    TIME_FOR_PRICE_IN1 = 2;
-static const char    TIME_FOR_PRICE_IN2 = 4;
-static const char    TIME_FOR_PRICE_IN3 = 6;
+// the parameters of the heuristics are in CS2Base::CS2Params
 
 static const Index   EMPTY_PUSH_COEF    = 1;
 
+static cIndex        PU_PAR_MIN         = 256;  // smaller buckets are
+                                                // scanned by one thread
+static cIndex        RF_WAVE_MIN        = 512;  // fewer active nodes are
+                                                // discharged in FIFO order
+static cIndex        BUCKETS_MIN        = 1024; // initial size of buckets[]
+static const size_t  AR_PAGE            = 4096; // stride of the first touch
+                                                // of the arena
+static cIndex        LD_PAR_MIN         = 1 << 16;  // fewer arcs are
+                                                    // loaded by one thread
+
 static const long MAX_CYCLES_CANCELLED  = 0;
 static const long START_CYCLE_CANCEL    = 100;
 
@@ -121,6 +114,11 @@ static const char WHITE = 0;
 static const char GREY  = 1;
 static const char BLACK = 2;
 
+static const size_t  BIN_BLOCK          = 1 << 20;  // raw bytes per block
+                                                    // of the binary format
+static const int     LZ_HASH            = 14;       // log of the size of
+                                                    // the table of lz_pack()
+
 /*--------------------------------------------------------------------------*/
 /*---------------------------- FUNCTIONS -----------------------------------*/
 /*--------------------------------------------------------------------------*/
@@ -145,6 +143,29 @@ inline T max( const T x , const T y )
 
 /*--------------------------------------------------------------------------*/
 
+// the number of threads of the current parallel region, and the index of
+// the calling one in it
+
+inline int THREADS_NUM( void )
+{
+ #ifdef _OPENMP
+  return( omp_get_num_threads() );
+ #else
+  return( 1 );
+ #endif
+ }
+
+inline int THREAD_ID( void )
+{
+ #ifdef _OPENMP
+  return( omp_get_thread_num() );
+ #else
+  return( 0 );
+ #endif
+ }
+
+/*--------------------------------------------------------------------------*/
+
 template<class T>
 inline void Swap( T &v1 , T &v2 )
 {
@@ -154,14 +175,417 @@ inline void Swap( T &v1 , T &v2 )
  v2 = temp;
  }
 
+/*--------------------------------------------------------------------------*/
+// the lowest price, the bound on epsilon below which the flow is optimal, and
+// x / y rounded up, for integer and for floating point prices
+
+template<class T>
+inline T PRICE_MIN( void )
+{
+ return( - ( std::numeric_limits< T >::max() / 2 - 1 ) );
+ }
+
+template<>
+inline double PRICE_MIN< double >( void )
+{
+ return( - ( C_INF / 2 ) * ( CNumber( 1 ) - C_em ) );
+ }
+
+template<class T>
+inline T LOW_BOUND( void )
+{
+ return( 1 );
+ }
+
+template<>
+inline double LOW_BOUND< double >( void )
+{
+ return( 1.00001 );
+ }
+
+template<class T>
+inline T CEIL_DIV( const T x , const T y )
+{
+ return( x / y + ( x % y ? 1 : 0 ) );
+ }
+
+inline double CEIL_DIV( const double x , const double y )
+{
+ return( ceil( x / y ) );
+ }
+
+/*--------------------------------------------------------------------------*/
+// a byte-oriented LZ77 compression of a block, in the style of LZ4: each
+// sequence is a token (literal count in the high nibble, match length - 4
+// in the low one, 15 meaning "continued in the following bytes, 255 at a
+// time"), the literals, and the 2-byte offset of the match; the last
+// sequence has literals only. lz_pack() returns the packed size, or 0 if it
+// would not be smaller than len; tab[] has 1 << LZ_HASH entries
+
+inline Index LZ_READ( const unsigned char *p )
+{
+ Index x;
+ memcpy( &x , p , 4 );
+ return( x );
+ }
+
+static void lz_len( unsigned char *&op , size_t l )
+{
+ for( ; l >= 255 ; l -= 255 )
+  *(op++) = 255;
+ *(op++) = (unsigned char) l;
+ }
+
+static size_t lz_pack( const unsigned char *src , size_t len ,
+		       unsigned char *dst , Index *tab )
+{
+ memset( tab , 0 , sizeof( Index ) << LZ_HASH );
+
+ const unsigned char *ip = src;
+ const unsigned char *anchor = src;
+ const unsigned char *const iend = src + len;
+ unsigned char *op = dst;
+ unsigned char *const oend = dst + len;
+
+ while( ip + 4 <= iend ) {
+  const Index seq = LZ_READ( ip );
+  const Index h = ( seq * 2654435761U ) >> ( 32 - LZ_HASH );
+  const unsigned char *cand = src + tab[ h ];
+  tab[ h ] = Index( ip - src );
+
+  if( ( cand >= ip ) || ( ip - cand > 65535 ) || ( LZ_READ( cand ) != seq ) ) {
+   ip += 1 + ( ( ip - anchor ) >> 6 );  // go faster in incompressible data
+   continue;
+   }
+
+  const size_t off = size_t( ip - cand );
+  const unsigned char *mp = ip + 4;
+  for( cand += 4 ; ( mp < iend ) && ( *mp == *cand ) ; mp++ , cand++ ) ;
+
+  const size_t lit = size_t( ip - anchor );
+  const size_t mtc = size_t( mp - ip ) - 4;
+  if( op + lit + lit / 255 + mtc / 255 + 8 > oend )
+   return( 0 );
+
+  unsigned char *tok = op++;
+  *tok = (unsigned char) ( ( lit < 15 ? lit : 15 ) << 4 );
+  if( lit >= 15 )
+   lz_len( op , lit - 15 );
+  memcpy( op , anchor , lit );
+  op += lit;
+  *(op++) = (unsigned char) off;
+  *(op++) = (unsigned char) ( off >> 8 );
+  *tok |= (unsigned char) ( mtc < 15 ? mtc : 15 );
+  if( mtc >= 15 )
+   lz_len( op , mtc - 15 );
+
+  anchor = ip = mp;
+  }
+
+ if( anchor < iend ) {  // the last literals
+  const size_t lit = size_t( iend - anchor );
+  if( op + lit + lit / 255 + 2 >= oend )
+   return( 0 );
+
+  *(op++) = (unsigned char) ( ( lit < 15 ? lit : 15 ) << 4 );
+  if( lit >= 15 )
+   lz_len( op , lit - 15 );
+  memcpy( op , anchor , lit );
+  op += lit;
+  }
+
+ return( size_t( op - dst ) );
+ }
+
+/*--------------------------------------------------------------------------*/
+// the inverse of lz_pack(), which must give exactly len bytes; FALSE if the
+// packed data is not valid
+
+static bool lz_unpack( const unsigned char *src , size_t plen ,
+		       unsigned char *dst , size_t len )
+{
+ const unsigned char *ip = src;
+ const unsigned char *const iend = src + plen;
+ unsigned char *op = dst;
+ unsigned char *const oend = dst + len;
+
+ while( op < oend ) {
+  if( ip == iend )
+   return( false );
+
+  const unsigned char tok = *(ip++);
+  size_t l = tok >> 4;
+  if( l == 15 )
+   for( unsigned char b = 255 ; b == 255 ; l += b ) {
+    if( ip == iend )
+     return( false );
+    b = *(ip++);
+    }
+
+  if( ( size_t( iend - ip ) < l ) || ( size_t( oend - op ) < l ) )
+   return( false );
+
+  memcpy( op , ip , l );
+  op += l;
+  ip += l;
+  if( op == oend )
+   break;
+
+  if( iend - ip < 2 )
+   return( false );
+
+  const size_t off = size_t( ip[ 0 ] ) | ( size_t( ip[ 1 ] ) << 8 );
+  ip += 2;
+  l = tok & 15;
+  if( l == 15 )
+   for( unsigned char b = 255 ; b == 255 ; l += b ) {
+    if( ip == iend )
+     return( false );
+    b = *(ip++);
+    }
+
+  l += 4;
+  if( ( off == 0 ) || ( off > size_t( op - dst ) ) ||
+      ( size_t( oend - op ) < l ) )
+   return( false );
+
+  for( const unsigned char *mp = op - off ; l-- ; )  // may overlap
+   *(op++) = *(mp++);
+  }
+
+ return( ip == iend );
+ }
+
+/*--------------------------------------------------------------------------*/
+// writes the columns of the binary format to a stream in blocks of
+// BIN_BLOCK bytes; if packed, each block is preceded by its raw and its
+// packed size (equal if it is stored as it is)
+
+static void write_blocks( ostream &s , const char *d , size_t len ,
+			  bool pack )
+{
+ if( ! pack ) {
+  s.write( d , len );
+  return;
+  }
+
+ unsigned char *pbuf = new unsigned char[ BIN_BLOCK ];
+ Index *tab = new Index[ 1 << LZ_HASH ];
+
+ for( ; len ; ) {
+  const size_t bl = ( len < BIN_BLOCK ? len : BIN_BLOCK );
+  const size_t pl = lz_pack( (const unsigned char *) d , bl , pbuf , tab );
+  const Index sz[ 2 ] = { Index( bl ) , Index( pl ? pl : bl ) };
+  s.write( (const char *) sz , sizeof( sz ) );
+  s.write( pl ? (const char *) pbuf : d , sz[ 1 ] );
+  d += bl;
+  len -= bl;
+  }
+
+ delete[] tab;
+ delete[] pbuf;
+ }
+
+/*--------------------------------------------------------------------------*/
+/*-------------------------- CS2Base METHODS -------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+void CS2Base::LoadBin( const char *FileName )
+{
+ OPTtimers t;
+ t.Start();
+
+ MappedFile f;
+ if( ! f.Open( FileName ) )
+  throw( MCFException( "LoadBin: cannot map the file" ) );
+
+ // check the header- - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+ const MCFBinHeader *h = (const MCFBinHeader *) f.Data();
+ if( ( f.Size() < sizeof( MCFBinHeader ) ) ||
+     memcmp( h->Magic , "MCFBIN\0" , 8 ) ||
+     ( h->Version < 1 ) || ( h->Version > 2 ) )
+  throw( MCFException( "LoadBin: not a binary MCF file" ) );
+
+ if( ( h->ISize != sizeof( Index ) ) || ( h->FSize != sizeof( FNumber ) ) ||
+     ( h->CSize != sizeof( CNumber ) ) )
+  throw( MCFException( "LoadBin: the sizes of the types do not match" ) );
+
+ cIndex tn = h->NNodes;
+ cIndex tm = h->NArcs;
+ const unsigned long long sz = (unsigned long long) tm *
+  ( 2 * sizeof( Index ) + sizeof( FNumber ) + sizeof( CNumber ) ) +
+  (unsigned long long) tn * sizeof( FNumber );
+
+ // find the columns: in the file, or unpacked from it - - - - - - - - - - -
+
+ const char *cols = (const char *) ( h + 1 );
+ char *raw = NULL;
+ if( h->Version == 1 ) {
+  if( f.Size() != sizeof( MCFBinHeader ) + sz )
+   throw( MCFException( "LoadBin: wrong file size" ) );
+  }
+ else {
+  if( sz != size_t( sz ) )
+   throw( MCFException( "LoadBin: the instance is too large" ) );
+
+  cols = raw = new char[ size_t( sz ) ];
+  const char *ip = (const char *) ( h + 1 );
+  const char *const iend = (const char *) f.Data() + f.Size();
+  size_t got = 0;
+  while( got < sz ) {
+   Index bs[ 2 ];  // raw and packed size of the block
+   if( size_t( iend - ip ) < sizeof( bs ) ) {
+    delete[] raw;
+    throw( MCFException( "LoadBin: wrong file size" ) );
+    }
+
+   memcpy( bs , ip , sizeof( bs ) );
+   ip += sizeof( bs );
+   bool ok = ( bs[ 0 ] <= sz - got ) && ( bs[ 1 ] <= size_t( iend - ip ) );
+   if( ok ) {
+    if( bs[ 1 ] == bs[ 0 ] )
+     memcpy( raw + got , ip , bs[ 0 ] );
+    else
+     ok = lz_unpack( (const unsigned char *) ip , bs[ 1 ] ,
+		     (unsigned char *) raw + got , bs[ 0 ] );
+    }
+   if( ( ! ok ) || ( ! bs[ 0 ] ) ) {
+    delete[] raw;
+    throw( MCFException( "LoadBin: corrupt packed data" ) );
+    }
+
+   ip += bs[ 1 ];
+   got += bs[ 0 ];
+   }
+
+  if( ip != iend ) {
+   delete[] raw;
+   throw( MCFException( "LoadBin: wrong file size" ) );
+   }
+
+  // the node columns are packed as differences from the previous entry
+
+  Index_Set tI = (Index_Set) raw;
+  for( Index i = 1 ; i < tm ; i++ ) {
+   tI[ i ] += tI[ i - 1 ];
+   tI[ tm + i ] += tI[ tm + i - 1 ];
+   }
+  }
+
+ cIndex_Set tStartn = (cIndex_Set) cols;
+ cIndex_Set tEndn = tStartn + tm;
+ cFRow tU = (cFRow) ( tEndn + tm );
+ cCRow tC = (cCRow) ( tU + tm );
+ cFRow tDfct = (cFRow) ( tC + tm );
+
+ // check the node names, and load the instance - - - - - - - - - - - - - - -
+
+ for( Index i = 0 ; i < tm ; i++ )
+  if( ( tStartn[ i ] + USENAME0 < 1 ) || ( tStartn[ i ] + USENAME0 > tn ) ||
+      ( tEndn[ i ] + USENAME0 < 1 ) || ( tEndn[ i ] + USENAME0 > tn ) ) {
+   delete[] raw;
+   throw( MCFException( "LoadBin: invalid node name" ) );
+   }
+
+ try {
+  LoadNet( tn , tm , tn , tm , tU , tC , tDfct , tStartn , tEndn );
+  }
+ catch( ... ) {
+  delete[] raw;
+  throw;
+  }
+
+ delete[] raw;
+
+ LdSt.Bytes = double( f.Size() );
+ LdSt.Time = t.Read();
+ LdSt.ReadTime = LdSt.Time - ld_net;
+
+ }  // end( CS2Base::LoadBin )
+
+/*--------------------------------------------------------------------------*/
+
+void CS2Base::LoadDMX( istream &DMXs )
+{
+ OPTtimers t;
+ t.Start();
+
+ DMXReader DMXr( DMXs );
+ ReadDMX( DMXr );
+
+ LdSt.Bytes = double( DMXr.Bytes() );
+ LdSt.Time = t.Read();
+ LdSt.ReadTime = LdSt.Time - ld_net;
+
+ }  // end( CS2Base::LoadDMX( istream ) )
+
+/*--------------------------------------------------------------------------*/
+
+void CS2Base::LoadDMX( const char *FileName )
+{
+ OPTtimers t;
+ t.Start();
+
+ MappedFile f;
+ if( ! f.Open( FileName ) )
+  throw( MCFException( "LoadDMX: cannot map the file" ) );
+
+ DMXReader DMXr( (const char *) f.Data() , f.Size() );
+ ReadDMX( DMXr );
+
+ LdSt.Bytes = double( f.Size() );
+ LdSt.Time = t.Read();
+ LdSt.ReadTime = LdSt.Time - ld_net;
+
+ }  // end( CS2Base::LoadDMX( char * ) )
+
 /*--------------------------------------------------------------------------*/
 /*--------------------------- COSTRUCTOR -----------------------------------*/
 /*--------------------------------------------------------------------------*/
 
-CS2::CS2( cIndex nmx , cIndex mmx )
+template< class FT , class CT >
+CS2T< FT , CT >::CS2T( cIndex nmx , cIndex mmx )
      :
-     MCFClass( nmx , mmx )
+     CS2Base( nmx , mmx )
 {
+ // the price update is sequential until told otherwise - - - - - - - - - - -
+
+ pu_thrds = 1;
+ pu_front = NULL;
+ pu_recs = NULL;
+ pu_rsize = 0;
+ pu_offs = new Index[ 2 ];
+ pu_ends = new Index[ 1 ];
+
+ rf_mode = kFIFORefine;
+ rf_thrds = 1;
+ rf_nds = NULL;
+ rf_rcv = NULL;
+ rf_rsize = 0;
+
+ // ordinary pages, on any node - - - - - - - - - - - - - - - - - - - - - - -
+
+ ar_huge = FALSE;
+ ar_node = -1;
+ ar_new = ar_touch = FALSE;
+ buckets = NULL;
+
+ ld_thrds = 1;
+ ld_hist = NULL;
+ ld_hsize = 0;
+
+ reset_stats();
+
+ tr_t = NULL;
+ tr_recs = NULL;
+ tr_size = tr_max = 0;
+
+ pt_used = NULL;
+ pt_taken = NULL;
+ pt_node = NULL;
+ pt_max = 0;
+
  // allocate memory - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 
  if( nmax && mmax )
@@ -174,17 +598,21 @@ CS2::CS2( cIndex nmx , cIndex mmx )
 /*-------------------------- OTHER INITIALIZATIONS -------------------------*/
 /*--------------------------------------------------------------------------*/
 
-void CS2::LoadNet( cIndex nmx , cIndex mmx , cIndex pn , cIndex pm ,
-		   cFRow pU , cCRow pC , cFRow pDfct , cIndex_Set pSn ,
-		   cIndex_Set pEn )
+template< class FT , class CT >
+void CS2T< FT , CT >::LoadNet( cIndex nmx , cIndex mmx , cIndex pn ,
+			       cIndex pm , cFRow pU , cCRow pC , cFRow pDfct ,
+			       cIndex_Set pSn , cIndex_Set pEn )
 {
+ OPTtimers ld_t;  // for GetLoadStatistics()
+ ld_t.Start();
+
  // allocating and deallocating memory- - - - - - - - - - - - - - - - - - - -
  // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 
  n = pn;
  m = pm;
 
- if( ( nmx != nmax ) || ( mmx != mmax ) ) {
+ if( ( nmx != nmax ) || ( mmx != mmax ) || ar_new ) {
   if( nmax && mmax ) {
    MemDeAlloc();
    nmax = mmax = 0;
@@ -199,167 +627,210 @@ void CS2::LoadNet( cIndex nmx , cIndex mmx , cIndex pn , cIndex pm ,
 
  if( ( ! nmax ) || ( ! mmax ) ) {  // just sit down in the corner and wait
   nmax = mmax = 0;
+  ar.Release();
   return;
   }
 
- // setting up the data structures- - - - - - - - - - - - - - - - - - - - - -
- // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+ // the first touch of a new block- - - - - - - - - - - - - - - - - - - - - -
+ // with more than one thread, each thread writes one contiguous slice of
+ // the block, so that its pages are spread over the nodes the threads run
+ // on; else, they are placed by the filling below, done by this thread
 
- sentinel_arc = arcs + 2 * m;
- sentinel_node = nodes + n + 1;
+ if( ar_touch ) {
+  ar_touch = FALSE;
+  Index nt = ( pu_thrds > rf_thrds ? pu_thrds : rf_thrds );
+  if( ld_thrds > nt )
+   nt = ld_thrds;
 
- dn = CNumber( n );
- 
- // allocating temporary vectors for the ordering - - - - - - - - - - - - - -
+  if( nt > 1 ) {
+   char *const pg = ar.Data();
+   const long npg = long( ( ar.Used() + AR_PAGE - 1 ) / AR_PAGE );
 
- Index_Set arc_tail = new Index[ 2 * m ];
-
- Index_Set arc_first = new Index[ n + 2 ];
- for( Index i = 0 ; i < n + 2 ; )
-  arc_first[ i++ ] = 0;
+   #pragma omp parallel for num_threads( int( nt ) ) schedule( static )
+   for( long h = 0 ; h < npg ; h++ )
+    pg[ h * AR_PAGE ] = 0;
+   }
+  }
 
- // setting up arcs[] - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+ // setting up the data structures- - - - - - - - - - - - - - - - - - - - - -
  // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 
- m_c = 0;
- arc_st* arc = arcs;
- for( Index i = 0 ; i <  m ; i++ , arc++ ) {
-  // read arc description - - - - - - - - - - - - - - - - - - - - - - - - - -
+ sentinel_arc = ARC( 2 * m );
+ sentinel_node = nodes + n + 1;
 
-  Index tail = *(pSn++) + USENAME0;
-  Index head = *(pEn++) + USENAME0;
-  FNumber acap  = ( pU ? *(pU++) : F_INF );         
-  CNumber dcost = ( pC ? *(pC++) : 0 );
+ // costs are scaled by n + 1: the algorithm stops with a 1-optimal flow,
+ // that is optimal only if 1 / dn < 1 / n, as a cycle has at most n arcs
 
-  // update maximum cost- - - - - - - - - - - - - - - - - - - - - - - - - - -
+ dn = PT( n + 1 );
+ 
+ // building the forward stars - - - - - - - - - - - - - - - - - - - - - - -
+ // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+ // The arcs[] vector is ordered by (Forward) Star, i.e., first all the arcs
+ // exiting from the first node, then all the arcs exiting from the second
+ // and so on. The position of the first arc exiting one given node is
+ // contained into node.first. Note that, since each arc is represented
+ // twice (the original arc and its "sister"), the forward and backward star
+ // of each node are mixed together.
+ //
+ // This is a two-pass counting sort: the first pass counts the arcs of each
+ // star, the second writes each arc, and its sister, straight into the next
+ // free position of the star of its tail (head), and records the two
+ // positions in pos[], so that no arc is ever moved; within each star, the
+ // arcs are in the order of their names. With ld_thrds threads, each thread
+ // takes a contiguous range of the arcs and counts them in a histogram of
+ // its own, and then the positions of each star are handed out to the
+ // threads in the order of their ranges, so that the result is the same as
+ // with one thread.
+
+ Index nt = ( ( ld_thrds > 1 ) && ( m >= LD_PAR_MIN ) ? ld_thrds : 1 );
+ if( nt > 1 ) {
+  if( nt * ( nmax + 2 ) > ld_hsize ) {
+   delete[] ld_hist;
+   ld_hsize = nt * ( nmax + 2 );
+   ld_hist = new Index[ ld_hsize ];
+   }
+  }
 
-  if( dcost < C_INF ) {
-   if( acap > 0 )
-    if( dcost > m_c )
-     m_c = dcost;
-    else
-     if( - dcost > m_c )
-      m_c = - dcost;
+ Index_Set hist = ( nt > 1 ? ld_hist : ld_first );
+ CNumber max_c = 0;
 
-   dcost *= dn;
-   }
+ #pragma omp parallel num_threads( int( nt ) )
+ {
+  cIndex t = THREAD_ID();
+  cIndex tn = THREADS_NUM();
+  cIndex i_strt = Index( ( double( m ) * t ) / tn );
+  cIndex i_stop = Index( ( double( m ) * ( t + 1 ) ) / tn );
 
-  // set the pos[] inverse map- - - - - - - - - - - - - - - - - - - - - - - -
+  // first pass: counting the arcs of each star and the maximum cost - - - -
+  // at the end, h[ i ] = number of arcs of the range outgoing from node i;
+  // if DYNMC_MCF_CS2 == 0, arcs with C_INF cost are not put in the star of
+  // their head/tail nodes, but rather put (as suspended arcs) in the star
+  // of the dummy node n + 1
 
-  pos[ i ] = arc;
+  Index_Set h = hist + t * ( n + 2 );
+  for( Index i = 0 ; i < n + 2 ; )
+   h[ i++ ] = 0;
 
-  // count this arc in the star of its head & tail- - - - - - - - - - - - - -
-  // at the end, arc_first[ i + 1 ] = number of arcs outgoing from node "i"
+  CNumber t_m_c = 0;
+  for( Index i = i_strt ; i < i_stop ; i++ ) {
+   const FNumber acap = ( pU ? pU[ i ] : F_INF );
+   const CNumber dcost = ( pC ? pC[ i ] : 0 );
 
-  #if( ! DYNMC_MCF_CS2 )
-   if( dcost < C_INF )
-  #endif
-   {
-    arc_first[ tail + 1 ]++;
-    arc_first[ head + 1 ]++;
+   if( dcost < C_INF ) {
+    if( acap > 0 ) {
+     if( dcost > t_m_c )
+      t_m_c = dcost;
+     else
+      if( - dcost > t_m_c )
+       t_m_c = - dcost;
+     }
     }
+   #if( ! DYNMC_MCF_CS2 )
+    else {
+     h[ n + 1 ] += 2;
+     continue;
+     }
+   #endif
 
-  // setting up the arc - - - - - - - - - - - - - - - - - - - - - - - - - - -
+   h[ pSn[ i ] + USENAME0 ]++;
+   h[ pEn[ i ] + USENAME0 ]++;
+   }
 
-  arc_tail[ 2 * i ] = tail;
-  arc->head = nodes + head;
-  arc->r_cap = acap;
+  #pragma omp critical
+  {
+   if( t_m_c > max_c )
+    max_c = t_m_c;
+   }
 
-  arc->cost = dcost;
-  arc->sister = arc + 1; 
-  arc->position = i + 1;
+  #pragma omp barrier
+  #pragma omp single
+  {
+   // the first position of each star, and of each range in it- - - - - - -
+
+   Index k = 0;
+   for( Index i = 0 ; i++ <= n ; ) {
+    nodes[ i ].first = ARC( k );
+    for( Index_Set hi = hist + i ; hi < hist + tn * ( n + 2 ) ;
+	 hi += n + 2 ) {
+     cIndex cnt = *hi;
+     *hi = k;
+     k += cnt;
+     }
+    }
+   }  // end( omp single ), with implied barrier
 
-  // setting up the sister arc- - - - - - - - - - - - - - - - - - - - - - - -
+  // second pass: setting up each arc and its sister in place - - - - - - - -
 
-  (arc + 1)->sister = arc;
+  for( Index i = i_strt ; i < i_stop ; i++ ) {
+   cIndex tail = pSn[ i ] + USENAME0;
+   cIndex head = pEn[ i ] + USENAME0;
+   const FNumber acap = ( pU ? pU[ i ] : F_INF );
+   const CNumber dcost = ( pC ? pC[ i ] : 0 );
+   #if( DYNMC_MCF_CS2 )
+    const CT scost = ( dcost < C_INF ? SCALED_COST( dcost ) : 0 );
+   #else
+    const CT scost = ( dcost < C_INF ? SCALED_COST( dcost ) : CST_INF() );
+   #endif
 
-  arc_tail[ 2 * i + 1 ] = head;
-  (++arc)->head = nodes + tail;
-  arc->r_cap = 0;
+   #if( DYNMC_MCF_CS2 )
+    const arc_t arc = ARC( h[ tail ]++ );
+    const arc_t sis = ARC( h[ head ]++ );
+   #else
+    const arc_t arc = ARC( h[ dcost < C_INF ? tail : n + 1 ]++ );
+    const arc_t sis = ARC( h[ dcost < C_INF ? head : n + 1 ]++ );
+   #endif
 
-  arc->cost = -dcost;
-  arc->position = -(i + 1);
+   SET_HEAD( arc , nodes + head );
+   RCAP( arc ) = ( acap < F_INF ? FT( acap ) : FLW_INF() );
+   COST( arc ) = scost;
+   POSITION( arc ) = i + 1;
 
-  }  // end( for( i ) )
+   SET_HEAD( sis , nodes + tail );
+   RCAP( sis ) = 0;
+   COST( sis ) = - scost;
+   POSITION( sis ) = -(i + 1);
 
- // reordering arcs[] - linear time algorithm - - - - - - - - - - - - - - - -
- // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
- // The arcs[] vector is ordered by (Forward) Star, i.e., first all the arcs
- // exiting from the first node, then all the arcs exiting from the second
- // and so on. The position of the first arc exiting one given node is
- // contained into node.first. Note that, since each arc is represented
- // twice (the original arc and its "sister"), the forward and backward star
- // of each node are mixed together.
- //
- // before the loop below, arc_first[ i + 1 ] is the number of arcs outgoing
- // from i; after the loop, arc_first[ i ] is the position of the first arc
- // outgoing from node i when the arcs are ordered; this value is transformed
- // to pointer and written to nodes[ i ].first
+   pos[ i ] = arc;
+   #if( CS2_INDEX_LINKS )
+    pos[ mmax + i ] = sis;
+   #else
+    SISTER( arc ) = sis;
+    SISTER( sis ) = arc;
+   #endif
+   }
+  }  // end( omp parallel )
 
- for( Index i = 0 ; i++ <= n ; ) {
-  arc_first[ i ] += arc_first[ i - 1 ];
-  nodes[ i ].first = arcs + arc_first[ i ];
-  }
+ m_c = max_c;
 
  sentinel_node->suspended = sentinel_node->first;
 
  #if( ! DYNMC_MCF_CS2 )
-  // if DYNMC_MCF_CS2 == 0, arcs with C_INF cost are not put in the star of
-  // their head/tail nodes, but rather put (as suspended arcs) in the star
-  // of the dummy node n + 1- - - - - - - - - - - - - - - - - - - - - - - - -
-
-  for( arc_st *arc = arcs ; arc < sentinel_node->suspended ; arc++ )
-   while( arc->cost == C_INF )
-    EXCHANGE( arc , (sentinel_node->first)++ );
+  sentinel_node->first = sentinel_arc;
  #else
   sentinel_node->closed = sentinel_node->suspended;
  #endif
 
- for( Index i = 1 ; i < n ; i++ )  // scanning all the nodes except the last
- {
-  cIndex last = ( ( nodes + i + 1 )->first ) - arcs;
-  for( Index arc_num = arc_first[ i ] ; arc_num < last ; arc_num++ )
-   for( Index tail = arc_tail[ arc_num ] ; tail != i ; ) {
-    // the arc arc_num is not in place because the arc in this position must
-    // go out from i; we'll put it to its place and continue this process
-    // until an arc in this position would go out from i
-
-    cIndex arc_new_num = arc_first[ tail ];
-    arc_st *arc = arcs + arc_num;
-    arc_st *arc_new = arcs + arc_new_num;
-
-    // arc must be in position arc_new: swapping these arcs
-
-    EXCHANGE( arc , arc_new );
-
-    arc_tail[ arc_num ] = arc_tail[ arc_new_num ];
-    arc_tail[ arc_new_num ] = tail;
-
-    arc_first[ tail ]++;  // signal that this arc is in a correct position
-                          // and need not to be examined again
-    tail = arc_tail[ arc_num ];
-    }
-  }
-
- // deallocating temporaries- - - - - - - - - - - - - - - - - - - - - - - - -
-
- delete[] arc_first;
- delete[] arc_tail;
-
  #if( DYNMC_MCF_CS2 )
   // put all closed arcs at the beginning of the star of their nodes- - - - -
   //- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 
-  for( node_st *node = nodes ; ++node < sentinel_node ; ) {
-   node->closed = node->first;
+  // (both the arc with C_INF cost and its sister); their cost has been set
+  // to 0, so that OpenArc() makes them ordinary arcs, hence the original
+  // costs are looked up by name
 
-   for( arc_st *arc = node->first ; arc < (node + 1)->first ; arc++ )
-    if( arc->cost == C_INF )
-     if( arc == node->first )
-      (node->first)++;
-     else
-      EXCHANGE( arc , ++(node->first) );
-   }
+  if( pC )
+   for( node_st *node = nodes ; ++node < sentinel_node ; ) {
+    node->closed = node->first;
+
+    for( arc_t arc = node->first ; arc < (node + 1)->first ; arc++ ) {
+     cSIndex ps = POSITION( arc );
+     if( pC[ ( ps > 0 ? ps : - ps ) - 1 ] >= C_INF )
+      EXCHANGE( arc , (node->first)++ );
+     }
+    }
+  else
+   for( node_st *node = nodes ; ++node < sentinel_node ; )
+    node->closed = node->first;
  #endif
  
  // setting up nodes[]- - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -367,9 +838,9 @@ void CS2::LoadNet( cIndex nmx , cIndex mmx , cIndex pn , cIndex pm ,
 
  for( node_st *node = nodes ; ++node < sentinel_node ; ) {
   node->suspended = node->first;
-  node->excess = - *(pDfct++);
-  node->b_next = NULL;
-  node->b_prev = NULL;
+  node->excess = ( pDfct ? - *(pDfct++) : 0 );
+  node->b_next = LINK( NULL );
+  node->b_prev = LINK( NULL );
   node->rank = 0;
   node->inp = 0;
   }
@@ -377,35 +848,166 @@ void CS2::LoadNet( cIndex nmx , cIndex mmx , cIndex pn , cIndex pm ,
  // setting up buckets[]- - - - - - - - - - - - - - - - - - - - - - - - - - -
  // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 
- for( bucket_st *b = buckets ; b < l_bucket ; b++ )
+ for( bucket_st *b = buckets + b_size ; b-- > buckets ; )
   RESET_BUCKET( b );
 
  // final initializations - - - - - - - - - - - - - - - - - - - - - - - - - -
 
- #if( CS2_STATISTICS )
-  n_push = n_relabel = n_discharge = n_refine = n_update = n_scan = 
-  n_prscan = n_prscan1 = n_prscan2 = n_prefine = 0;
- #endif
+ reset_stats();
 
  empty_push_bound = n * EMPTY_PUSH_COEF;
  status = kUnSolved;
+ ld_net = ld_t.Read();
 
  }  // end( CS2::LoadNet )
 
+/*-------------------------------------------------------------------------*/
+
+template< class FT , class CT >
+void CS2T< FT , CT >::SetPriceUpdateThreads( cIndex nt )
+{
+ pu_thrds = ( nt ? nt : 1 );
+
+ delete[] pu_ends;
+ delete[] pu_offs;
+ pu_offs = new Index[ pu_thrds + 1 ];
+ pu_ends = new Index[ pu_thrds ];
+ }
+
+/*-------------------------------------------------------------------------*/
+
+template< class FT , class CT >
+void CS2T< FT , CT >::SetLoadThreads( cIndex nt )
+{
+ ld_thrds = ( nt ? nt : 1 );
+ }
+
+/*-------------------------------------------------------------------------*/
+
+template< class FT , class CT >
+void CS2T< FT , CT >::SetRefine( CS2Refine rf , cIndex nt )
+{
+ rf_mode = rf;
+ rf_thrds = ( nt ? nt : 1 );
+ }
+
+/*-------------------------------------------------------------------------*/
+
+template< class FT , class CT >
+void CS2T< FT , CT >::SetMemory( cBOOL HugePages , int NumaNode )
+{
+ if( NumaNode < 0 )
+  NumaNode = -1;
+
+ if( ( HugePages != ar_huge ) || ( NumaNode != ar_node ) ) {
+  ar_huge = HugePages;
+  ar_node = NumaNode;
+  ar_new = TRUE;  // see LoadNet()
+  }
+ }
+
+/*-------------------------------------------------------------------------*/
+
+template< class FT , class CT >
+void CS2T< FT , CT >::SetParams( const CS2Params &NewPar )
+{
+ if( NewPar.ScaleFactor < 2 )
+  throw( MCFException( "CS2::SetParams: ScaleFactor must be at least 2" ) );
+ if( NewPar.PriceOutStart < 1 )
+  throw( MCFException( "CS2::SetParams: PriceOutStart must be at least 1" ) );
+
+ // the "infinite" rank depends on the scale factor, see MemAlloc(); the
+ // buckets already there are kept, since they are empty between two calls
+
+ if( nmax )
+  linf = Index( nmax * NewPar.ScaleFactor + 2 );
+
+ Par = NewPar;
+ }
+
+/*-------------------------------------------------------------------------*/
+
+template< class FT , class CT >
+typename CS2T< FT , CT >::CS2Stats CS2T< FT , CT >::GetStatistics( void )
+{
+ CS2Stats st;
+ st.NRefine = n_ref;
+ st.Time = st_time;
+
+ #if( CS2_STATISTICS )
+  st.NPush = n_push;
+  st.NRelabel = n_relabel;
+  st.NDischarge = n_discharge;
+  st.NWave = n_wave;
+  st.NUpdate = n_update;
+  st.NScan = n_scan;
+  st.NPRefine = n_prefine;
+  st.NPrScan = n_prscan;
+  st.NPrScan1 = n_prscan1;
+  st.NPrScan2 = n_prscan2;
+ #endif
+
+ return( st );
+ }
+
+/*-------------------------------------------------------------------------*/
+
+template< class FT , class CT >
+CNumber CS2T< FT , CT >::GetEpsilon( void )
+{
+ return( CNumber( epsilon ) / CNumber( dn ) );
+ }
+
+/*-------------------------------------------------------------------------*/
+
+template< class FT , class CT >
+void CS2T< FT , CT >::SetTrace( cBOOL TraceIt )
+{
+ if( TraceIt ) {
+  if( ! tr_t )
+   tr_t = new OPTtimers();
+  }
+ else {
+  delete tr_t;
+  tr_t = NULL;
+  tr_size = 0;
+  }
+ }
+
+/*-------------------------------------------------------------------------*/
+
+template< class FT , class CT >
+const typename CS2T< FT , CT >::CS2TrRec *CS2T< FT , CT >::GetTrace(
+							      Index &Size )
+{
+ Size = tr_size;
+ return( tr_recs );
+ }
+
 /*-------------------------------------------------------------------------*/
 /*--------------- METHODS FOR SOLVING THE PROBLEM -------------------------*/
 /*-------------------------------------------------------------------------*/
 
-void CS2::SolveMCF( void )
+template< class FT , class CT >
+void CS2T< FT , CT >::SolveMCF( void )
 {
  ObjVal = FO_INF;
 
+ const double t_strt = ( MCFt ? MCFt->Read() : 0 );
  if( MCFt )
   MCFt->Start();
 
+ tr_size = 0;
+ if( tr_t ) {
+  tr_t->ReSet();
+  tr_t->Start();
+  }
+
  // initialization- - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
  // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 
+ const BOOL restart = ( status != kUnSolved );
+
  if( status == kUnSolved ) {  // construct an initial "empty" solution- - - -
   // set prices to 0
      
@@ -413,32 +1015,58 @@ void CS2::SolveMCF( void )
    i->price = 0;   
    i->first = i->suspended;
    i->current = i->first;
-   i->q_next = sentinel_node;
+   i->q_next = LINK( sentinel_node );
    }
 
   // compute starting epsilon
  
-  epsilon = m_c * dn; 
+  epsilon = PT( m_c * dn ); 
   if( epsilon < 1 )
    epsilon = 1;
  
   Blncd = FALSE;
   }
  else {  // restart with the previous solution- - - - - - - - - - - - - - - -
-  // make prices non negative
-
-  CNumber rc = 0;
   for( node_st *i = nodes ; ++i < sentinel_node ; ) {
-   if( rc < i->price)
-    rc = i->price;
- 
    i->first = i->suspended;
    i->current = i->first; 
-   i->q_next = sentinel_node;
+   i->q_next = LINK( sentinel_node );
    }
+
+  // the nodes that relabel() found with no way out have price - INF, but
+  // the changes since may have given them residual arcs, along which the
+  // flow would look hugely non optimal: each such node gets the smallest
+  // price that keeps its residual arcs towards nodes with a finite price
+  // non violating, until no price changes; the others keep - INF
+
+  for( BOOL chg = TRUE ; chg ; ) {
+   chg = FALSE;
+   for( node_st *i = nodes ; ++i < sentinel_node ; )
+    if( i->price <= PRICE_MIN< PT >() ) {
+     PT p = PRICE_MIN< PT >();
+     for( arc_t a = i->first , a_stop = (i + 1)->closed ; a < a_stop ;
+	  a++ )
+      if( FGTZ( RCAP( a ) , EPS_FLW() ) &&
+	  ( HEAD( a )->price > PRICE_MIN< PT >() ) )
+       p = max( p , PT( HEAD( a )->price - COST( a ) ) );
+
+     if( p > PRICE_MIN< PT >() ) {
+      i->price = p;
+      chg = TRUE;
+      }
+     }
+   }
+
+  // make prices non positive, leaving alone those that are - INF
+
+  PT rc = 0;
+  for( node_st *i = nodes ; ++i < sentinel_node ; )
+   if( rc < i->price)
+    rc = i->price;
   
   for( node_st *i = nodes ; ++i < sentinel_node ; )
-   i->price -= rc;
+   if( i->price > PRICE_MIN< PT >() )
+    i->price -= rc;
  
   // compute starting epsilon
 
@@ -446,27 +1074,20 @@ void CS2::SolveMCF( void )
    epsilon = dn;
 
    // compute the maximum (in absolute value) of the reduced cost of arcs
-   // violating the complementary slackness condition
+   // violating the complementary slackness condition: the flow is
+   // epsilon-optimal for it, and optimal if it is not larger than 1
 
-   CNumber sum = 0;
-   for( node_st *i = nodes ; ++i < sentinel_node ; ) {
-    CNumber minc = 0;
-    for( arc_st *a = i->first , *a_stop = (i + 1)->closed ; a < a_stop ;
+   PT max_rc = 0;
+   for( node_st *i = nodes ; ++i < sentinel_node ; )
+    for( arc_t a = i->first , a_stop = (i + 1)->closed ; a < a_stop ;
 	 a++ )
-     if( FGTZ( a->r_cap , EpsFlw ) ) {
-      cCNumber rc = REDUCED_COST( i , a->head , a );
-      if( CLTZ( rc , EpsCst ) )
-       minc = max( minc , CNumber( - rc ) ) ;
+     if( FGTZ( RCAP( a ) , EPS_FLW() ) ) {
+      const PT rc = REDUCED_COST( i , HEAD( a ) , a );
+      if( CLTZ( rc , EPS_CST() ) )
+       max_rc = max( max_rc , PT( - rc ) ) ;
        }
 
-    sum += minc;
-    }
-
-   #if( Ctype == REAL_TYPE )
-    epsilon = ceil( sum / dn );
-   #else
-    epsilon = sum / dn + ( sum % dn ? 1 : 0 );
-   #endif
+   epsilon = max_rc;
 
    if( epsilon < 1 )
     epsilon = 1;
@@ -475,45 +1096,41 @@ void CS2::SolveMCF( void )
    epsilon = 1;
 
    // the new epsilon value is taken as the minimum reduced cost between
-   // residual arcs
+   // residual arcs, so that the flow is epsilon-optimal
 
    for( node_st *i = nodes ; ++i < sentinel_node ; )
-    for( arc_st *a = i->first , *a_stop = (i + 1)->closed ; a < a_stop ;
+    for( arc_t a = i->first , a_stop = (i + 1)->closed ; a < a_stop ;
 	 a++ )
-     if FGTZ( a->r_cap, EpsFlw ) { 
-      cCNumber rc = REDUCED_COST( i , a->head , a );
+     if FGTZ( RCAP( a ), EPS_FLW() ) { 
+      const PT rc = REDUCED_COST( i , HEAD( a ) , a );
       if ( rc < -epsilon )
        epsilon = -rc ;   
       }
  
-   // every arc with absolute cost less then 2 * dn * epsilon is considered
-   // closed into subroutine refine
- 
-   if( 2 * epsilon < m_c )
-    epsilon = m_c * dn * SCALE_DEFAULT;
-   
-   // relabel nodes with positive excess
+   // relabel nodes with positive excess, which keeps the flow
+   // epsilon-optimal
 
    for( node_st *i = nodes ; ++i < sentinel_node ; )
     if( i->excess > 0 )
      relabel( i );
 
+   // the first refine() must run with this very epsilon, while the
+   // update_epsilon() below divides it by the scale factor
+
+   epsilon *= PT( Par.ScaleFactor );
+
    }  // end( the flow may not be balanced )
   }  // end( restart with the previous solution ) - - - - - - - - - - - - - -
  
- cut_off_factor = CUT_OFF_COEF * pow( dn , CUT_OFF_POWER );
- cut_off_factor = max( cut_off_factor , CUT_OFF_MIN );
+ cut_off_factor = Par.CutOffCoef * pow( dn , Par.CutOffPower );
+ cut_off_factor = max( cut_off_factor , Par.CutOffMin );
 
- n_ref = 0; 
  n_rel = 0;
  flag_price = FALSE;
  n_bad_pricein = n_bad_relabel = 0;
  empty_push_bound = n * EMPTY_PUSH_COEF;
 
- #if( CS2_STATISTICS )
-  n_push = n_relabel = n_discharge = n_refine = n_update = n_scan =
-           n_prscan = n_prscan1 = n_prscan2 = n_prefine = 0;
- #endif
+ reset_stats();
 
  excq_first = NULL;
 
@@ -533,7 +1150,7 @@ void CS2::SolveMCF( void )
     if( ! price_refine() )
      break;
 
-    if( ( n_ref >= PRICE_OUT_START ) && price_in() )
+    if( ( n_ref >= Par.PriceOutStart ) && price_in() )
      break;     
 
     if( ( cc = update_epsilon() ) )
@@ -548,7 +1165,7 @@ void CS2::SolveMCF( void )
    if( status )  // problem unfeasible or error
     break;     
 
-   if( n_ref >= PRICE_OUT_START )
+   if( n_ref >= Par.PriceOutStart )
     price_out();
 
    if( update_epsilon() )
@@ -566,7 +1183,7 @@ void CS2::SolveMCF( void )
    if( status )  // problem unfeasible or error
     break;  
 
-   if( n_ref >= PRICE_OUT_START )
+   if( n_ref >= Par.PriceOutStart )
     price_out();
 
    if( update_epsilon() ) 
@@ -576,7 +1193,7 @@ void CS2::SolveMCF( void )
     if( ! price_refine() )
      break;
 
-    if( ( n_ref >= PRICE_OUT_START ) && price_in() )
+    if( ( n_ref >= Par.PriceOutStart ) && price_in() )
      break;
 
     if( ( cc = update_epsilon() ) )
@@ -603,81 +1220,176 @@ void CS2::SolveMCF( void )
   compute_prices();
 
   for( node_st *i = nodes ; ++i < sentinel_node ; )
-   for( arc_st *a = i->first , *a_stop = (i + 1)->closed ; a < a_stop ;
+   for( arc_t a = i->first , a_stop = (i + 1)->closed ; a < a_stop ;
 	a++ )
-    if( FGTZ( a->r_cap , EpsFlw ) )
-     if( (i->price) + (a->cost) - (a->head)->price < - epsilon )
+    if( FGTZ( RCAP( a ) , EPS_FLW() ) )
+     if( (i->price) + (COST( a )) - (HEAD( a ))->price < - epsilon )
       throw( MCFException( "Error: wrong reduced cost" ) );
    }
  #endif
 
- if( status )
-  Blncd = TRUE;
+ // an optimal flow is balanced, and can be the starting point of a
+ // reoptimization; anything else has to restart from a possibly non
+ // balanced flow
 
- if( MCFt )
+ Blncd = ( status == kOK );
+
+ if( MCFt ) {
   MCFt->Stop();
+  st_time = MCFt->Read() - t_strt;
+  }
 
+ if( tr_t )
+  tr_t->Stop();
+
+ // a restart runs the first refine() with a small epsilon, and the first
+ // price_update() only looks linf buckets of epsilon far: the sources it
+ // leaves out need not be unreachable, so a restart that finds the problem
+ // unfeasible checks it again from scratch, with the flow it has left
+
+ if( ( status == kUnfeasible ) && restart ) {
+  const double t_rst = st_time;
+  status = kUnSolved;
+  SolveMCF();
+  st_time += t_rst;
+  }
  } // end( CS2::SolveMCF )
 
 /*--------------------------------------------------------------------------*/
 /*---------------------- METHODS FOR READING RESULTS -----------------------*/
 /*--------------------------------------------------------------------------*/
 
-void CS2::MCFGetX( register FRow F , register Index_Set nms ,
-  		   cIndex strt , Index stp )
+template< class FT , class CT >
+void CS2T< FT , CT >::MCFGetX( register FRow F , register Index_Set nms ,
+			       cIndex strt , Index stp )
 {
  if( stp > m )
   stp = m; 
 
- if( nms )
+ if( nms ) {
   for( Index i = strt ; i < stp ; i++ ) {
-   cFNumber Xi = (pos[ i ]->sister)->r_cap;
-   if( FGTZ( Xi , EpsFlw ) )
+   const FT Xi = RCAP( SISTER( pos[ i ] ) );
+   if( FGTZ( Xi , EPS_FLW() ) )
    {
     *(F++) = Xi;
     *(nms++) = i;
     }
    }
+
+  *nms = InINF;  // as promised by MCFClass::MCFGetX()
+  }
  else
   for( Index i = strt ; i < stp ; i++ )
-   *(F++) = (pos[ i ]->sister)->r_cap;
+   *(F++) = RCAP( SISTER( pos[ i ] ) );
 
  }  // end( CS2::MCFGetX() )
 
 /*--------------------------------------------------------------------------*/
 
-void CS2::MCFGetRC( register CRow CR , register cIndex_Set nms ,
-  		    cIndex strt , Index stp  )
+template< class FT , class CT >
+Index CS2T< FT , CT >::MCFGetPaths( cIndex_Set Strt , cIndex ns ,
+				    Index_Set Path , Index_Set Offs ,
+				    cIndex maxlen )
+{
+ // the used flow is moved back into the residual capacities while walking,
+ // so that two paths never use the same unit of flow, and then restored:
+ // the arcs and the flow taken from them are remembered in pt_used[] and
+ // pt_taken[], one entry per entry of Path[], which only grow
+
+ Index len = 0;
+ BOOL fits = TRUE;
+
+ for( Index i = 0 ; ( i < ns ) && fits ; i++ ) {
+  Offs[ i ] = len;
+  node_st *node = nodes + Strt[ i ] + USENAME0;
+
+  for(;;) {
+   arc_t a = node->suspended;
+   arc_t a_stop = (node + 1)->closed;
+   for( ; a < a_stop ; a++ )
+    if( ( POSITION( a ) > 0 ) && FGTZ( RCAP( SISTER( a ) ) , EPS_FLW() ) )
+     break;
+
+   if( a == a_stop )   // no flow left out of node: the path ends here
+    break;
+
+   if( Path && ( len == maxlen ) ) {
+    fits = FALSE;
+    break;
+    }
+
+   if( len == pt_max )
+    pt_grow( len );
+
+   const FT unit = min( RCAP( SISTER( a ) ) , FT( 1 ) );
+   RCAP( SISTER( a ) ) -= unit;
+   RCAP( a ) += unit;
+   pt_used[ len ] = a;
+   pt_taken[ len ] = unit;
+   node = HEAD( a );
+   ( Path ? Path : pt_node )[ len++ ] = ( node - nodes ) - USENAME0;
+   }
+  }
+
+ if( fits )
+  Offs[ ns ] = len;
+
+ for( Index h = len ; h-- ; ) {  // restore the flow
+  RCAP( pt_used[ h ] ) -= pt_taken[ h ];
+  RCAP( SISTER( pt_used[ h ] ) ) += pt_taken[ h ];
+  }
+
+ return( fits ? len : InINF );
+
+ }  // end( CS2::MCFGetPaths() )
+
+/*--------------------------------------------------------------------------*/
+
+template< class FT , class CT >
+cIndex_Set CS2T< FT , CT >::MCFGetPathNodes( void )
+{
+ return( pt_node );
+
+ }  // end( CS2::MCFGetPathNodes() )
+
+/*--------------------------------------------------------------------------*/
+
+template< class FT , class CT >
+void CS2T< FT , CT >::MCFGetRC( register CRow CR , register cIndex_Set nms ,
+				cIndex strt , Index stp  )
 {
  if( nms ) {
   while( *nms < strt )
    nms++;
 
   for( register Index h ; ( h = *(nms++) ) < stp ; )
-   *(CR++) = CS2::MCFGetRC( h );
+   *(CR++) = CS2T::MCFGetRC( h );
   }
  else {
   if( stp > m )
    stp = m;
 
   for( register Index i = strt ; i < stp ; i++ )
-   *(CR++) = CS2::MCFGetRC( i );
+   *(CR++) = CS2T::MCFGetRC( i );
   }
  }  // end( CS2::MCFGetRC( some ) )   
 
 /*--------------------------------------------------------------------------*/
 
-inline CNumber CS2::MCFGetRC( cIndex i )
+template< class FT , class CT >
+inline CNumber CS2T< FT , CT >::MCFGetRC( cIndex i )
 {
- arc_st* arc = pos[ i ];
- return( REDUCED_COST( arc->sister->head , arc->head , arc ) / dn );
+ arc_t arc = pos[ i ];
+ return( CNumber( REDUCED_COST( HEAD( SISTER( arc ) ) , HEAD( arc ) , arc ) )
+	 / CNumber( dn ) );
 
  } // end( CS2::MCFGetRC( some ) )
 
 /*--------------------------------------------------------------------------*/
 
-void CS2::MCFGetPi( register CRow P , register cIndex_Set nms ,
-		    cIndex strt , Index stp )
+template< class FT , class CT >
+void CS2T< FT , CT >::MCFGetPi( register CRow P , register cIndex_Set nms ,
+				cIndex strt , Index stp )
 {
  register node_st *nds = nodes + 1;
 
@@ -686,48 +1398,234 @@ void CS2::MCFGetPi( register CRow P , register cIndex_Set nms ,
    nms++;
 
   for( register Index h ; ( h = *(nms++) ) < stp ; )
-   *(P++) = nds[ h ].price / dn;
+   *(P++) = CNumber( nds[ h ].price ) / CNumber( dn );
   }
  else {
   if( stp > n )
    stp = n;
 
   for( register Index i = strt ; i < stp ; i++ )
-   *(P++) = nds[ i ].price / dn;
+   *(P++) = CNumber( nds[ i ].price ) / CNumber( dn );
   }
  }  // end( CS2::MCFGetPi( some ) )
 
 /*--------------------------------------------------------------------------*/
 
-FONumber CS2::MCFGetFO( void )
+template< class FT , class CT >
+FONumber CS2T< FT , CT >::MCFGetFO( void )
 { 
  if( status == kOK ) {
   if( ObjVal == FO_INF ) {
    ObjVal = 0;
-   arc_st **a = pos;
+   arc_t *a = pos;
    for( Index i = m ; i-- ; a++ )
-    if( ((*a)->sister)->r_cap )    
-     ObjVal += FONumber( (*a)->cost ) * FONumber( ((*a)->sister)->r_cap );  
+    if( RCAP( SISTER( *a ) ) )    
+     ObjVal += FONumber( COST( *a ) ) * FONumber( RCAP( SISTER( *a ) ) );  
+
+   ObjVal /=  dn;
+   }
+
+  return( ObjVal );
+  }
+ else
+  if( status == kUnbounded )
+   return( - FO_INF );
+  else
+   return( FO_INF );
+
+ }  // end( CS2::MCFGetFO )
+
+/*--------------------------------------------------------------------------*/
+
+template< class FT , class CT >
+FNumber CS2T< FT , CT >::MCFGetUnfCut( Index_Set Cut )
+{
+ // when the solver stops as unfeasible the flow and the excesses are left
+ // as they were: the sources it could not drain are those that the reverse
+ // visit of price_update() does not reach from the sinks, and the nodes
+ // they reach in the residual graph are the cut; the visits use Cut[] as
+ // their queue and the rank of the nodes as marks (1 = in the cut, -1 =
+ // reached from the sinks), and scan the suspended arcs too, which are
+ // still in the residual graph if price_out() left them out of the stars
+
+ *Cut = InINF;
+ if( status != kUnfeasible )
+  return( 0 );
+
+ Index qt = 0;
+ for( node_st *i = nodes ; ++i < sentinel_node ; )
+  if( FLTZ( i->excess , EPS_DFCT() ) ) {
+   i->rank = -1;
+   Cut[ qt++ ] = i - nodes;
+   }
+  else
+   i->rank = 0;
+
+ for( Index qh = 0 ; qh < qt ; ) {  // reverse visit from the sinks- - - - -
+  node_st *i = nodes + Cut[ qh++ ];
+  for( arc_t a = i->suspended , a_stop = (i + 1)->closed ; a < a_stop ;
+       a++ ) {
+   node_st *j = HEAD( a );
+   if( ( ! j->rank ) && FGTZ( RCAP( SISTER( a ) ) , EPS_FLW() ) ) {
+    j->rank = -1;
+    Cut[ qt++ ] = j - nodes;
+    }
+   }
+  }
+
+ qt = 0;
+ for( node_st *i = nodes ; ++i < sentinel_node ; )
+  if( ( ! i->rank ) && FGTZ( i->excess , EPS_DFCT() ) ) {
+   i->rank = 1;
+   Cut[ qt++ ] = i - nodes;
+   }
+
+ for( Index qh = 0 ; qh < qt ; ) {  // forward visit from the sources- - - -
+  node_st *i = nodes + Cut[ qh++ ];
+  for( arc_t a = i->suspended , a_stop = (i + 1)->closed ; a < a_stop ;
+       a++ ) {
+   node_st *j = HEAD( a );
+   if( ( ! j->rank ) && FGTZ( RCAP( a ) , EPS_FLW() ) ) {
+    j->rank = 1;
+    Cut[ qt++ ] = j - nodes;
+    }
+   }
+  }
+
+ // write the names in order and sum the deficits- - - - - - - - - - - - - -
+
+ FNumber Dfct = 0;
+ Index_Set tC = Cut;
+ for( node_st *i = nodes ; ++i < sentinel_node ; )
+  if( i->rank > 0 ) {
+   Dfct += CS2T::MCFDfct( Index( i - nodes ) - 1 );
+   *(tC++) = Index( i - nodes ) - USENAME0;
+   }
+
+ *tC = InINF;
+ return( Dfct );
+
+ }  // end( CS2::MCFGetUnfCut )
+
+/*--------------------------------------------------------------------------*/
+
+template< class FT , class CT >
+MCFClass::MCFStatePtr CS2T< FT , CT >::MCFGetState( void )
+{
+ CS2State *S = new CS2State( n , m );
+
+ for( Index i = 0 ; i < n ; i++ )
+  S->price[ i ] = nodes[ i + 1 ].price;
+
+ for( Index i = 0 ; i < m ; i++ )
+  S->flow[ i ] = RCAP( SISTER( pos[ i ] ) );
+
+ S->epsilon = epsilon;
+ S->Blncd = Blncd;
+ S->status = status;
+
+ return( S );
+
+ }  // end( CS2::MCFGetState )
+
+/*--------------------------------------------------------------------------*/
+
+template< class FT , class CT >
+void CS2T< FT , CT >::MCFPutState( MCFStatePtr Sp )
+{
+ const CS2State *S = dynamic_cast< const CS2State * >( Sp );
+ if( ( ! S ) || ( S->n != n ) || ( S->m != m ) )
+  throw( MCFException( "CS2::MCFPutState: not a state of this instance" ) );
+
+ // the deficits stay the current ones, so read them before the flow changes
+
+ FRow tDfct = new FNumber[ n ];
+ CS2T::MCFDfcts( tDfct );
+
+ // activate the suspended arcs, so that the excesses below account for the
+ // flow on all the open arcs
+
+ for( node_st *i = nodes ; ++i < sentinel_node ; ) {
+  i->first = i->suspended;
+  i->current = i->first;
+  }
+
+ // put back the flow on the open arcs, within their current capacities- - -
+
+ BOOL bal = S->Blncd;
+ for( Index i = 0 ; i < m ; i++ ) {
+  if( CS2T::IsClosedArc( i ) )  // closed arcs have no flow
+   continue;
+
+  arc_t a = pos[ i ];
+  arc_t sis = SISTER( a );
+  const FT u = RCAP( a ) + RCAP( sis );
+  FT f = S->flow[ i ];
+  if( f > u ) {
+   f = u;
+   bal = FALSE;
+   }
+
+  RCAP( sis ) = f;
+  RCAP( a ) = u - f;
+  }
+
+ // recompute the excesses from the deficits, as in MCFDfct() - - - - - - - -
+
+ node_st *node = nodes + 1;
+ for( Index j = 0 ; j < n ; j++ , node++ ) {
+  FT exc = FT( - tDfct[ j ] );
+  for( arc_t a = node->first , a_stop = ( node + 1 )->closed ; a < a_stop ;
+       a++ )
+   if( POSITION( a ) > 0 )  // direct arc leaving from j
+    exc -= RCAP( SISTER( a ) );
+   else                     // inverse arc entering j
+    exc += RCAP( a );
+
+  node->excess = exc;
+  if( ! FETZ( exc , EPS_DFCT() ) )
+   bal = FALSE;
+
+  node->price = S->price[ j ];
+  }
+
+ delete[] tDfct;
 
-   ObjVal /=  dn;
-   }
+ epsilon = S->epsilon;
+ Blncd = bal;
+ ObjVal = FO_INF;  // recomputed from the flow if asked
 
-  return( ObjVal );
+ // a saved optimum is still one only if the flow is balanced and epsilon
+ // optimal with the saved prices, which changes of the deficits, costs or
+ // capacities after MCFGetState() may have spoilt; if not, kStopped says
+ // that there is no solution, and SolveMCF() still starts from the flow
+
+ status = S->status;
+ if( status == kOK ) {
+  BOOL opt = bal;
+  for( node_st *i = nodes ; opt && ( ++i < sentinel_node ) ; )
+   for( arc_t a = i->first , a_stop = (i + 1)->closed ; a < a_stop ; a++ )
+    if( FGTZ( RCAP( a ) , EPS_FLW() ) &&
+	( REDUCED_COST( i , HEAD( a ) , a ) < - epsilon ) ) {
+     opt = FALSE;
+     break;
+     }
+
+  if( ! opt )
+   status = kStopped;
   }
- else
-  if( status == kUnbounded )
-   return( - FO_INF );
-  else
-   return( FO_INF );
 
- }  // end( CS2::MCFGetFO )
+ }  // end( CS2::MCFPutState )
 
 /*--------------------------------------------------------------------------*/
 /*-------------- METHODS FOR READING THE DATA OF THE PROBLEM ---------------*/
 /*--------------------------------------------------------------------------*/
 
-void CS2::MCFArcs( register Index_Set Startv , register Index_Set Endv ,
-		   register cIndex_Set nms , cIndex strt , Index stp )
+template< class FT , class CT >
+void CS2T< FT , CT >::MCFArcs( register Index_Set Startv ,
+			       register Index_Set Endv ,
+			       register cIndex_Set nms , cIndex strt ,
+			       Index stp )
 {
  if( stp > m )
   stp = m;
@@ -740,118 +1638,209 @@ void CS2::MCFArcs( register Index_Set Startv , register Index_Set Endv ,
   if( Endv )
    if( nms )
     for( register Index h ; ( h = *(nms++) ) < stp ; ) {
-     *(Startv++) = CS2::MCFSNde( h );
-     *(Endv++)   = CS2::MCFENde( h );
+     *(Startv++) = CS2T::MCFSNde( h );
+     *(Endv++)   = CS2T::MCFENde( h );
      }
    else
     for( register Index i = strt ; i < stp ; i++ ) {
-     *(Startv++) = CS2::MCFSNde( i );
-     *(Endv++)   = CS2::MCFENde( i );
+     *(Startv++) = CS2T::MCFSNde( i );
+     *(Endv++)   = CS2T::MCFENde( i );
      }
   else
    if( nms )
     for( register Index h ; ( h = *(nms++) ) < stp ; )
-     *(Startv++) = CS2::MCFSNde( h );
+     *(Startv++) = CS2T::MCFSNde( h );
    else
     for( register Index i = strt ; i < stp ; i++ )
-     *(Startv++) = CS2::MCFSNde( i );
+     *(Startv++) = CS2T::MCFSNde( i );
  else
-  if( Endv )
+  if( Endv ) {
    if( nms )
     for( register Index h ; ( h = *(nms++) ) < stp ; )
-     *(Endv++) = CS2::MCFENde( h );
+     *(Endv++) = CS2T::MCFENde( h );
    else
     for( register Index i = strt ; i < stp ; i++ )
-     *(Endv++) = CS2::MCFENde( i );
+     *(Endv++) = CS2T::MCFENde( i );
+   }
 
  }  // end( CS2::MCFArcs )
 
 /*--------------------------------------------------------------------------*/
   
-void CS2::MCFCosts( register CRow Costv , register cIndex_Set nms ,
-		    cIndex strt , Index stp  )
+template< class FT , class CT >
+void CS2T< FT , CT >::MCFCosts( register CRow Costv , register cIndex_Set nms ,
+				cIndex strt , Index stp  )
 {
  if( nms ) {
   while( *nms < strt )
    nms++;
 
   for( register Index h ; ( h = *(nms++) ) < stp ; )
-   *(Costv++) = pos[ h ]->cost;
+   *(Costv++) = COST( pos[ h ] );
   }
  else {
   if( stp > m )
    stp = m;
 
   for( register Index i = strt ; i < stp ; i++ )
-   *(Costv++) = pos[ i ]->cost;           
+   *(Costv++) = COST( pos[ i ] );           
   }
  }  // end( CS2::MCFCosts )
 
 /*--------------------------------------------------------------------------*/
 
-void CS2::MCFUCaps( register FRow UCapv , register cIndex_Set nms ,
-		    cIndex strt , Index stp  )
+template< class FT , class CT >
+void CS2T< FT , CT >::MCFUCaps( register FRow UCapv , register cIndex_Set nms ,
+				cIndex strt , Index stp  )
 {
  if( nms ) {
   while( *nms < strt )
    nms++;
 
   for( register Index h ; ( h = *(nms++) ) < stp ; )
-   *(UCapv++) = CS2::MCFUCap( h );
+   *(UCapv++) = CS2T::MCFUCap( h );
   }
  else {
   if( stp > m )
    stp = n;
 
   for( register Index i = strt ; i < stp ; i++ )
-   *(UCapv++) = CS2::MCFUCap( i );
+   *(UCapv++) = CS2T::MCFUCap( i );
   }
  }  // end( CS2::MCFUCaps )
 
 /*--------------------------------------------------------------------------*/
 
-void CS2::MCFDfcts( register FRow Dfctv , register cIndex_Set nms ,
-		    cIndex strt , Index stp  )
+template< class FT , class CT >
+void CS2T< FT , CT >::MCFDfcts( register FRow Dfctv , register cIndex_Set nms ,
+				cIndex strt , Index stp  )
 {
  if( nms ) {
   while( *nms < strt )
    nms++;
 
   for( register Index h ; ( h = *(nms++) ) < stp ; )
-   *(Dfctv++) = CS2::MCFDfct( h );
+   *(Dfctv++) = CS2T::MCFDfct( h );
   }
  else {
   if( stp > n )
    stp = n;
 
   for( register Index i = strt ; i < stp ; i++ )
-   *(Dfctv++) = CS2::MCFDfct( i );
+   *(Dfctv++) = CS2T::MCFDfct( i );
   }
  }  // end( CS2::MCFDfcts )
 
 /*-------------------------------------------------------------------------*/
 
-inline FNumber CS2::MCFDfct( cIndex i )
+template< class FT , class CT >
+inline FNumber CS2T< FT , CT >::MCFDfct( cIndex i )
 {
  node_st *node = nodes + i + 1;
  register FNumber Dfcti = node->excess;
 
- arc_st *a_stop = ( node + 1 )->closed;
- for( arc_st *a = node->first ; a < a_stop ; a++ )
-  if( a->position > 0 )  // direct arc leaving from i   
-   Dfcti += a->sister->r_cap;
+ arc_t a_stop = ( node + 1 )->closed;
+ for( arc_t a = node->first ; a < a_stop ; a++ )
+  if( POSITION( a ) > 0 )  // direct arc leaving from i   
+   Dfcti += RCAP( SISTER( a ) );
   else                   // inverse arcs entering i
-   Dfcti -= a->r_cap;
+   Dfcti -= RCAP( a );
 
  return( - Dfcti );
  }
 
+/*-------------------------------------------------------------------------*/
+
+template< class FT , class CT >
+void CS2T< FT , CT >::SaveBin( ostream &oStrm , cBOOL Pack )
+{
+ // write the header- - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+ MCFBinHeader h;
+ memcpy( h.Magic , "MCFBIN\0" , 8 );
+ h.Version = ( Pack ? 2 : 1 );
+ h.ISize = sizeof( Index );
+ h.FSize = sizeof( FNumber );
+ h.CSize = sizeof( CNumber );
+ h.NNodes = n;
+ h.NArcs = m;
+ oStrm.write( (const char *) &h , sizeof( h ) );
+
+ // gather the columns- - - - - - - - - - - - - - - - - - - - - - - - - - - -
+ // the stars are walked in the order of the arcs in memory, and each
+ // original arc is scattered to its name, rather than going through pos[]
+ // in the order of the names, which would jump around in memory; the
+ // capacities and deficits are computed as in MCFUCap() and MCFDfct()
+
+ const size_t sz = size_t( m ) * ( 2 * sizeof( Index ) + sizeof( FNumber ) +
+				   sizeof( CNumber ) ) +
+                   size_t( n ) * sizeof( FNumber );
+ char *cols = new char[ sz ];
+ Index_Set tSn = (Index_Set) cols;
+ Index_Set tEn = tSn + m;
+ FRow tU = (FRow) ( tEn + m );
+ CRow tC = (CRow) ( tU + m );
+ FRow tDfct = (FRow) ( tC + m );
+
+ node_st *node = nodes + 1;
+ for( Index j = 0 ; j < n ; j++ , node++ ) {
+  FNumber Dfctj = node->excess;
+  cIndex nm = Index( node - nodes ) - USENAME0;
+
+  arc_t a_stop = ( node + 1 )->closed;
+  for( arc_t a = node->closed ; a < a_stop ; a++ ) {
+   cSIndex p = POSITION( a );
+   if( p > 0 ) {   // direct arc leaving from j
+    const FT f = RCAP( SISTER( a ) );
+    const FT u = RCAP( a ) + f;
+    tSn[ p - 1 ] = nm;
+    tEn[ p - 1 ] = Index( HEAD( a ) - nodes ) - USENAME0;
+    tU[ p - 1 ] = ( IntFlw && ( u >= FLW_INF() ) ? F_INF : FNumber( u ) );
+    tC[ p - 1 ] = ( a < node->suspended ? C_INF :
+		    CNumber( COST( a ) ) / CNumber( dn ) );
+    if( a >= node->first )
+     Dfctj += f;
+    }
+   else            // inverse arc entering j
+    if( a >= node->first )
+     Dfctj -= RCAP( a );
+   }
+
+  tDfct[ j ] = - Dfctj;
+  }
+
+ // write them- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+ if( Pack )  // the node columns are packed as differences
+  for( Index i = m ; i-- > 1 ; ) {
+   tSn[ i ] -= tSn[ i - 1 ];
+   tEn[ i ] -= tEn[ i - 1 ];
+   }
+
+ write_blocks( oStrm , cols , sz , Pack ? true : false );
+ delete[] cols;
+
+ }  // end( CS2::SaveBin )
+
+/*-------------------------------------------------------------------------*/
+
+template< class FT , class CT >
+void CS2T< FT , CT >::WriteMCF( ostream &oStrm , int frmt )
+{
+ if( frmt == kBinary )
+  SaveBin( oStrm );
+ else
+  MCFClass::WriteMCF( oStrm , frmt );
+ }
+
 /*-------------------------------------------------------------------------*/
 /*--------- METHODS FOR ADDING / REMOVING / CHANGING DATA -----------------*/
 /*-------------------------------------------------------------------------*/
  
-void CS2::ChgCosts( register cCRow NCost , register cIndex_Set nms ,
-		    cIndex strt , Index stp )
+template< class FT , class CT >
+void CS2T< FT , CT >::ChgCosts( register cCRow NCost ,
+				register cIndex_Set nms , cIndex strt ,
+				Index stp )
 {
  if( nms ) {
   while( *nms < strt ) {
@@ -877,7 +1866,8 @@ void CS2::ChgCosts( register cCRow NCost , register cIndex_Set nms ,
 
 /*--------------------------------------------------------------------------*/
 
-void CS2::ChgCost( register Index arc , cCNumber NCost )
+template< class FT , class CT >
+void CS2T< FT , CT >::ChgCost( register Index arc , cCNumber NCost )
 {
  updtarccst( pos[ arc ] , NCost );
 
@@ -888,11 +1878,12 @@ void CS2::ChgCost( register Index arc , cCNumber NCost )
 
 /*--------------------------------------------------------------------------*/
 
-void CS2::ChgDfcts( register cFRow NDfct ,register cIndex_Set nms ,
-		    cIndex strt , Index stp )
+template< class FT , class CT >
+void CS2T< FT , CT >::ChgDfcts( register cFRow NDfct ,register cIndex_Set nms ,
+				cIndex strt , Index stp )
 {
- if( stp > m )
-  stp = m;
+ if( stp > n )
+  stp = n;
 
  if( nms ) {
   while( *nms < strt ) {
@@ -901,22 +1892,19 @@ void CS2::ChgDfcts( register cFRow NDfct ,register cIndex_Set nms ,
    }
 
   for( register Index h ; ( h = *(nms++) ) < stp ; NDfct++) {
-   cFNumber oldfct = CS2::MCFDfct( h );  // remember old deficit
+   cFNumber oldfct = CS2T::MCFDfct( h );  // remember old deficit
 
-   nodes[ h + 1 ].excess += oldfct - *NDfct; 
+   nodes[ h + 1 ].excess += FT( oldfct - *NDfct ); 
    
    if( FETZ( oldfct , EpsDfct ) && ( ! FETZ( *NDfct , EpsDfct ) ) )
     nodes[ h + 1 ].price = 0;
    }
   }
  else {
-  if( stp > n )
-   stp = n;
-
-  for( register Index i = strt ; i++ < stp ; NDfct++ ) {
-   cFNumber oldfct = CS2::MCFDfct( i );  // remember old deficit
+  for( register Index i = strt ; i < stp ; i++ , NDfct++ ) {
+   cFNumber oldfct = CS2T::MCFDfct( i );  // remember old deficit
 
-   nodes[ i + 1 ].excess += oldfct - *NDfct;
+   nodes[ i + 1 ].excess += FT( oldfct - *NDfct );
 
    if( FETZ( oldfct , EpsDfct ) && ( ! FETZ( *NDfct , EpsDfct ) ) )
     nodes[ i + 1 ].price = 0;   
@@ -932,11 +1920,12 @@ void CS2::ChgDfcts( register cFRow NDfct ,register cIndex_Set nms ,
 
 /*--------------------------------------------------------------------------*/
 
-void CS2::ChgDfct( register Index nod , cFNumber NDfct )
+template< class FT , class CT >
+void CS2T< FT , CT >::ChgDfct( register Index nod , cFNumber NDfct )
 {  
- cFNumber oldfct = CS2::MCFDfct( nod );  // remember old deficit
+ cFNumber oldfct = CS2T::MCFDfct( nod );  // remember old deficit
 
- nodes[ nod + 1 ].excess += oldfct - NDfct;
+ nodes[ nod + 1 ].excess += FT( oldfct - NDfct );
 
  if( FETZ( oldfct , EpsDfct ) && ( ! FETZ( NDfct , EpsDfct ) ) )
   nodes[ nod + 1 ].price = 0;   
@@ -950,8 +1939,9 @@ void CS2::ChgDfct( register Index nod , cFNumber NDfct )
 
 /*--------------------------------------------------------------------------*/
 
-void CS2::ChgUCaps( register cFRow NCap , register cIndex_Set nms ,
-		    cIndex strt , Index stp )
+template< class FT , class CT >
+void CS2T< FT , CT >::ChgUCaps( register cFRow NCap , register cIndex_Set nms ,
+				cIndex strt , Index stp )
 {
  if( nms ) {
   while( *nms < strt ) {
@@ -977,7 +1967,8 @@ void CS2::ChgUCaps( register cFRow NCap , register cIndex_Set nms ,
 
 /*--------------------------------------------------------------------------*/
 
-void CS2::ChgUCap( register Index arc , cFNumber NCap )
+template< class FT , class CT >
+void CS2T< FT , CT >::ChgUCap( register Index arc , cFNumber NCap )
 {
  updtarccap( pos[ arc ] , NCap );
 
@@ -988,24 +1979,25 @@ void CS2::ChgUCap( register Index arc , cFNumber NCap )
 
 /*--------------------------------------------------------------------------*/
 
-void CS2::CloseArc( cIndex name ) 
+template< class FT , class CT >
+void CS2T< FT , CT >::CloseArc( cIndex name )
 {
  #if( DYNMC_MCF_CS2 )
-  arc_st *arc = pos[ name ];
-  arc_st *sis = arc->sister;
+  arc_t arc = pos[ name ];
+  arc_t sis = SISTER( arc );
 
-  if( arc < sis->head->suspended )   // the arc is already closed
+  if( arc < HEAD( sis )->suspended )   // the arc is already closed
    return;                           // quietly return
       
-  node_st *head = arc->head;
-  node_st *tail = sis->head;
+  node_st *head = HEAD( arc );
+  node_st *tail = HEAD( sis );
 
   // if there is flow on the arc, set the flow to 0 and signal that something
   // other than costs have changed; otherwise, pretend that the cost of the
   // closed arc has in fact gone to +INF
  
-  if( FGTZ( sis->r_cap , EpsFlw ) ) {
-   INCREASE_FLOW( tail , head , arc , -(sis->r_cap) );
+  if( FGTZ( RCAP( sis ) , EPS_FLW() ) ) {
+   INCREASE_FLOW( tail , head , arc , -(RCAP( sis )) );
    Blncd = FALSE;
    }
 
@@ -1016,6 +2008,15 @@ void CS2::CloseArc( cIndex name )
   // close reverse arc
 
   EXCHANGE( sis , (head->suspended)++ );
+
+  // the closed region may have grown past the suspended one; the suspended
+  // arcs are made active again at the start of SolveMCF() anyway
+
+  if( tail->first < tail->suspended )
+   tail->first = tail->suspended;
+
+  if( head->first < head->suspended )
+   head->first = head->suspended;
  
   if( ! Senstv )
    status = kUnSolved;
@@ -1029,14 +2030,20 @@ void CS2::CloseArc( cIndex name )
 
 /*--------------------------------------------------------------------------*/
 
-void CS2::DelNode( cIndex name )
+template< class FT , class CT >
+void CS2T< FT , CT >::DelNode( cIndex name )
 {
  #if( DYNMC_MCF_CS2 )
-  for( arc_st *a = nodes[ name ].suspended ,
-	      *a_stop = nodes[ name + 1 ].closed ; a < a_stop ; a++ )
-   CloseArc( a - arcs );
+  // closing an arc of the star moves it to node->suspended and advances
+  // it, so keep closing the first non-closed arc until none is left
+
+  node_st *node = nodes + name + 1;
+  while( node->suspended < (node + 1)->closed ) {
+   cSIndex ps = POSITION( node->suspended );
+   CloseArc( ( ps > 0 ? ps : - ps ) - 1 );
+   }
 
-  CS2::ChgDfct( name , FNumber( 0 ) );
+  CS2T::ChgDfct( name , FNumber( 0 ) );
  #else
   throw(
    MCFException( "CS2::DelNode() not implemented if DYNMC_MCF_CS2 == 0"
@@ -1047,17 +2054,18 @@ void CS2::DelNode( cIndex name )
 
 /*--------------------------------------------------------------------------*/
 
-void CS2::OpenArc( cIndex name ) 
+template< class FT , class CT >
+void CS2T< FT , CT >::OpenArc( cIndex name )
 {
  #if( DYNMC_MCF_CS2 )
-  arc_st *arc = pos[ name ];
-  arc_st *sis = arc->sister;
+  arc_t arc = pos[ name ];
+  arc_t sis = SISTER( arc );
 
-  if( arc >= sis->head->suspended )   // the arc is already open
+  if( arc >= HEAD( sis )->suspended )   // the arc is already open
    return;
 
-  node_st *head = arc->head;
-  node_st *tail = sis->head;
+  node_st *head = HEAD( arc );
+  node_st *tail = HEAD( sis );
 
   // open direct arc
 
@@ -1072,7 +2080,7 @@ void CS2::OpenArc( cIndex name )
 
   Blncd = FALSE;
 
-  if( tail->price == PRICE_MIN )
+  if( tail->price == PRICE_MIN< PT >() )
    tail->price = 0;
  #else
   throw(
@@ -1084,7 +2092,8 @@ void CS2::OpenArc( cIndex name )
 
 /*--------------------------------------------------------------------------*/
 
-Index CS2::AddNode( cFNumber aDfct )
+template< class FT , class CT >
+Index CS2T< FT , CT >::AddNode( cFNumber aDfct )
 {
  throw( MCFException( "CS2::AddNode() not implemented yet" ) );
 
@@ -1093,21 +2102,25 @@ Index CS2::AddNode( cFNumber aDfct )
 
 /*--------------------------------------------------------------------------*/
 
-void CS2::ChangeArc( cIndex name , cIndex nSN , cIndex nEN )
+template< class FT , class CT >
+void CS2T< FT , CT >::ChangeArc( cIndex name , cIndex nSN , cIndex nEN )
 { 
  throw( MCFException( "CS2::ChangeArc() not implemented yet" ) );
  }
 
 /*--------------------------------------------------------------------------*/
 
-void CS2::DelArc( cIndex name )
+template< class FT , class CT >
+void CS2T< FT , CT >::DelArc( cIndex name )
 {
  CloseArc( name );  // limited implementation
  }
 
 /*--------------------------------------------------------------------------*/
 
-Index CS2::AddArc( cIndex Start , cIndex End , cFNumber aU , cCNumber aC )
+template< class FT , class CT >
+Index CS2T< FT , CT >::AddArc( cIndex Start , cIndex End , cFNumber aU ,
+			       cCNumber aC )
 {
  throw( MCFException( "CS2::AddArc() not implemented yet" ) );
 
@@ -1118,17 +2131,29 @@ Index CS2::AddArc( cIndex Start , cIndex End , cFNumber aU , cCNumber aC )
 /*------------------------------ DESTRUCTOR --------------------------------*/
 /*--------------------------------------------------------------------------*/
 
-CS2::~CS2()
+template< class FT , class CT >
+CS2T< FT , CT >::~CS2T()
 {
  if( nmax && mmax )
   MemDeAlloc();
+
+ delete[] pu_ends;
+ delete[] pu_offs;
+
+ delete tr_t;
+ delete[] tr_recs;
+
+ delete[] pt_node;
+ delete[] pt_taken;
+ delete[] pt_used;
  }
 
 /*--------------------------------------------------------------------------*/
 /*-------------------------- PRIVATE METHODS -------------------------------*/
 /*--------------------------------------------------------------------------*/
 
-inline void CS2::updtarccst( arc_st *arc , cCNumber NCa )
+template< class FT , class CT >
+inline void CS2T< FT , CT >::updtarccst( arc_t arc , cCNumber NCa )
 {
  if( NCa > m_c )
   m_c = NCa;
@@ -1136,35 +2161,38 @@ inline void CS2::updtarccst( arc_st *arc , cCNumber NCa )
   if( - NCa > m_c )
    m_c = - NCa;
 
- cCNumber SNCa = NCa * dn;
+ const CT SNCa = SCALED_COST( NCa );
 
- arc->cost = SNCa;
- (arc->sister)->cost = - SNCa;
+ COST( arc ) = SNCa;
+ COST( SISTER( arc ) ) = - SNCa;
  }
 
 /*--------------------------------------------------------------------------*/
 
-inline void CS2::updtarccap( arc_st *arc , cFNumber NCa )
+template< class FT , class CT >
+inline void CS2T< FT , CT >::updtarccap( arc_t arc , cFNumber NCa )
 {
- arc_st *sis = arc->sister;
- if( NCa < sis->r_cap ) {     // new capacity < current flow on arc
-  cFNumber DCap = sis->r_cap - NCa;  // decrease flow on arc of DCap > 0
+ const FT Cap = ( NCa < F_INF ? FT( NCa ) : FLW_INF() );
+ arc_t sis = SISTER( arc );
+ if( Cap < RCAP( sis ) ) {     // new capacity < current flow on arc
+  const FT DCap = RCAP( sis ) - Cap;  // decrease flow on arc of DCap > 0
 
-  sis->head->excess += DCap;  // update arc tail excess
-  sis->r_cap = NCa;           // update residual capacity of reverse arc
+  HEAD( sis )->excess += DCap;  // update arc tail excess
+  RCAP( sis ) = Cap;           // update residual capacity of reverse arc
 
-  arc->head->excess -= DCap;  // update arc head excess
-  arc->r_cap = 0;             // update residual capacity of forward arc
+  HEAD( arc )->excess -= DCap;  // update arc head excess
+  RCAP( arc ) = 0;             // update residual capacity of forward arc
 
   Blncd = FALSE;
   }
  else   
-  arc->r_cap = NCa - sis->r_cap;  // update residual capacity of forward arc
+  RCAP( arc ) = Cap - RCAP( sis );  // update residual capacity of forward arc
  }
 
 /*--------------------------------------------------------------------------*/
 
-BOOL CS2::price_update( void )
+template< class FT , class CT >
+BOOL CS2T< FT , CT >::price_update( void )
 {
  // The push-relabel method modifies prices locally, one node at a time.
  // The Price Update heuristic modifies prices in a more global way. In
@@ -1185,9 +2213,10 @@ BOOL CS2::price_update( void )
  // suspended arcs
 
  Increase( n_update );
+ tr_guard tg( this , kTrPriceUpdate );
 
  for( node_st *i = nodes ; ++i < sentinel_node ; )
-  if( FLTZ( i->excess , EpsDfct ) ) {
+  if( FLTZ( i->excess , EPS_DFCT() ) ) {
    INSERT_TO_BUCKET( i , buckets );
    i->rank = 0;
    }
@@ -1202,11 +2231,24 @@ BOOL CS2::price_update( void )
  // main loop - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
  // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 
- bucket_st *b = buckets;
- for( ; b < l_bucket ; b++ ) {
-  while( NONEMPTY_BUCKET( b ) ) {
+ // buckets[] may be reallocated when a node is moved to a bucket not there
+ // yet, hence buckets are addressed by rank; only the buckets up to top,
+ // the farthest one a node has ever been moved to, can be nonempty
+
+ SIndex r = 0;
+ SIndex top = 0;
+ for( ; r <= top ; r++ ) {
+  if( pu_thrds > 1 ) {
+   scan_bucket_par( r , remain , top );
+   if( ! remain )
+    break;
+
+   continue;
+   }
+
+  while( NONEMPTY_BUCKET( buckets + r ) ) {
    node_st *i;
-   GET_FROM_BUCKET( i , b );
+   GET_FROM_BUCKET( i , buckets + r );
 
    // update the rank of node "i" and, tor each arc (i, j) of the forward
    // star of "i", of "j" - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -1215,22 +2257,22 @@ BOOL CS2::price_update( void )
 
    SIndex i_rank = i->rank;
 
-   for( arc_st *a = i->first , *a_stop = (i + 1)->closed ; a < a_stop ; a++ )
+   for( arc_t a = i->first , a_stop = (i + 1)->closed ; a < a_stop ; a++ )
    {
-    arc_st *ra = a->sister;  // an arc (j, i)
+    arc_t ra = SISTER( a );  // an arc (j, i)
 
-    if( FGTZ( ra->r_cap , EpsFlw ) ) {
-     node_st *j = a->head;
+    if( FGTZ( RCAP( ra ) , EPS_FLW() ) ) {
+     node_st *j = HEAD( a );
      SIndex j_rank = j->rank;
 
      if( j_rank > i_rank ) {
       SIndex j_new_rank;
-      cCNumber rc = REDUCED_COST( j , i , ra );
-      if( CLTZ( rc , EpsCst ) )
+      const PT rc = REDUCED_COST( j , i , ra );
+      if( CLTZ( rc , EPS_CST() ) )
        j_new_rank = i_rank;
       else {
-       SIndex dr = SIndex( rc / epsilon );
-       j_new_rank = ( dr < linf ? i_rank + dr + 1 : linf );
+       const PT dr = rc / epsilon;
+       j_new_rank = ( dr < linf ? i_rank + SIndex( dr ) + 1 : linf );
        }
 
       if( j_rank > j_new_rank ) {  // the rank of j has decreased
@@ -1240,7 +2282,9 @@ BOOL CS2::price_update( void )
        if( j_rank < linf )         // update position of j in the bucket
 	REMOVE_FROM_BUCKET( j , buckets + j_rank );
 
-       INSERT_TO_BUCKET( j , buckets + j_new_rank );
+       INSERT_TO_BUCKET( j , BUCKET( j_new_rank ) );
+       if( j_new_rank > top )
+	top = j_new_rank;
        }
       }
      }
@@ -1253,7 +2297,7 @@ BOOL CS2::price_update( void )
 
    // check if all sources have been reached- - - - - - - - - - - - - - - - -
 
-   if( FGTZ( i->excess , EpsDfct ) )
+   if( FGTZ( i->excess , EPS_DFCT() ) )
     if( ! (--remain) )
      break;
 
@@ -1283,11 +2327,14 @@ BOOL CS2::price_update( void )
  // practice, while it appears to be able to send the algorithm into an
  // infinite loop, so we don't do it.
 
- cCNumber dp = ( b - buckets ) * epsilon;
+ if( r > top )  // all the buckets have been scanned, the farther ones
+  r = linf;     // being empty
+
+ const PT dp = r * epsilon;
 
  #if( EPS_FLOW )
   /*!!
-  FNumber xcss = 0;  // total excess of non-reached nodes that cannot be
+  FT xcss = 0;  // total excess of non-reached nodes that cannot be
                      // "absorbed" by balanced nodes; note that we assume
                      // all balanced node and non-reached sources to live
                      // in the same connected component
@@ -1299,13 +2346,13 @@ BOOL CS2::price_update( void )
    if( i->rank < linf )
     REMOVE_FROM_BUCKET( i , buckets + i->rank );
 
-   if( i->price > PRICE_MIN  )
+   if( i->price > PRICE_MIN< PT >()  )
     i->price -= dp;
 
    #if( EPS_FLOW )
     /*!!
-    if( i->excess <= EpsDfct )     // a balanced node can absorb
-     xcss -= EpsDfct - i->excess;  // this much flow staying balanced
+    if( i->excess <= EPS_DFCT() )     // a balanced node can absorb
+     xcss -= EPS_DFCT() - i->excess;  // this much flow staying balanced
     else
      xcss += i->excess;
     !!*/
@@ -1314,7 +2361,7 @@ BOOL CS2::price_update( void )
 
  #if( EPS_FLOW )
   /*!!
-  if( FLEZ( xcss , EpsDfct ) )
+  if( FLEZ( xcss , EPS_DFCT() ) )
    remain = 0;
    !!*/
  #endif
@@ -1328,23 +2375,168 @@ BOOL CS2::price_update( void )
 
 /*--------------------------------------------------------------------------*/
 
-BOOL CS2::relabel( node_st *i )
+template< class FT , class CT >
+void CS2T< FT , CT >::scan_bucket_par( cSIndex r , Index &remain ,
+				       SIndex &top )
+{
+ // The nodes of a bucket can be scanned in any order: the ranks (and so the
+ // prices) price_update() ends up with are the lengths of the shortest
+ // paths to the sinks, capped at the bucket where it stops, and these do
+ // not depend on the order. So the nodes currently in bucket r are scanned
+ // together, each thread taking a contiguous slice of them; the ranks are
+ // only read while scanning, which makes the decreases found (of the rank
+ // of a node j reached from a node i in r) independent from the scheduling
+ // of the threads, and they are applied afterwards, thread by thread. The
+ // decreases to the rank of r itself put nodes back in r, which is then
+ // scanned again.
+
+ if( ! pu_front )
+  pu_front = new node_st*[ nmax ];
+
+ const SIndex i_rank = r;
+ Index nthr = 1;
+
+ while( NONEMPTY_BUCKET( buckets + r ) ) {
+  // move the nodes in r to pu_front[]- - - - - - - - - - - - - - - - - - - -
+
+  Index nf = 0;
+  while( NONEMPTY_BUCKET( buckets + r ) )
+   GET_FROM_BUCKET( pu_front[ nf++ ] , buckets + r );
+
+  // scan them, recording the rank decreases- - - - - - - - - - - - - - - - -
+
+  #pragma omp parallel num_threads( nf < PU_PAR_MIN ? 1 : int( pu_thrds ) )
+  {
+   cIndex t = THREAD_ID();
+   cIndex nt = THREADS_NUM();
+   node_st **f = pu_front + nf * t / nt;
+   node_st **f_stop = pu_front + nf * ( t + 1 ) / nt;
+
+   // each thread has room for one record per arc of its slice
+
+   Index na = 0;
+   for( node_st **fi = f ; fi < f_stop ; fi++ ) {
+    node_st *i = *fi;
+    arc_t a_stop = (i + 1)->closed;
+    if( a_stop > i->first )
+     na += ARC_NUM( a_stop ) - ARC_NUM( i->first );
+    }
+
+   pu_offs[ t + 1 ] = na;
+
+   #pragma omp barrier
+   #pragma omp single
+   {
+    nthr = nt;
+    pu_offs[ 0 ] = 0;
+    for( Index h = 0 ; h < nt ; h++ )
+     pu_offs[ h + 1 ] += pu_offs[ h ];
+
+    if( pu_offs[ nt ] > pu_rsize ) {
+     delete[] pu_recs;
+     pu_rsize = pu_offs[ nt ];
+     pu_recs = new pu_rec_st[ pu_rsize ];
+     }
+    }  // end( omp single ), with implied barrier
+
+   pu_rec_st *rec = pu_recs + pu_offs[ t ];
+
+   for( ; f < f_stop ; f++ ) {
+    node_st *i = *f;
+
+    for( arc_t a = i->first , a_stop = (i + 1)->closed ; a < a_stop ; a++ )
+    {
+     arc_t ra = SISTER( a );  // an arc (j, i)
+
+     if( FGTZ( RCAP( ra ) , EPS_FLW() ) ) {
+      node_st *j = HEAD( a );
+      SIndex j_rank = j->rank;
+
+      if( j_rank > i_rank ) {
+       SIndex j_new_rank;
+       const PT rc = REDUCED_COST( j , i , ra );
+       if( CLTZ( rc , EPS_CST() ) )
+	j_new_rank = i_rank;
+       else {
+	const PT dr = rc / epsilon;
+	j_new_rank = ( dr < linf ? i_rank + SIndex( dr ) + 1 : linf );
+        }
+
+       if( j_rank > j_new_rank ) {
+	rec->node = j;
+	rec->arc = ra;
+	rec->rank = j_new_rank;
+	rec++;
+        }
+       }
+      }
+     }  // end( for( all arcs from i ) )
+    }  // end( for( all nodes of the slice ) )
+
+   pu_ends[ t ] = Index( rec - pu_recs );
+
+   }  // end( omp parallel )
+
+  // update price and rank of the scanned nodes- - - - - - - - - - - - - - -
+
+  for( Index k = 0 ; k < nf ; k++ ) {
+   node_st *i = pu_front[ k ];
+   Increase( n_scan );
+
+   i->price -= i_rank * epsilon;
+   i->rank = -1;
+
+   if( FGTZ( i->excess , EPS_DFCT() ) )
+    remain--;
+   }
+
+  // apply the rank decreases- - - - - - - - - - - - - - - - - - - - - - - - -
+
+  for( Index h = 0 ; h < nthr ; h++ )
+   for( pu_rec_st *rec = pu_recs + pu_offs[ h ] ,
+	          *rec_stop = pu_recs + pu_ends[ h ] ; rec < rec_stop ; rec++ )
+   {
+    node_st *j = rec->node;
+    cSIndex j_rank = j->rank;
+
+    if( j_rank > rec->rank ) {  // the rank of j has decreased
+     j->rank = rec->rank;
+     j->current = rec->arc;     // update j->current
+
+     if( j_rank < linf )        // update position of j in the bucket
+      REMOVE_FROM_BUCKET( j , buckets + j_rank );
+
+     INSERT_TO_BUCKET( j , BUCKET( rec->rank ) );
+     if( rec->rank > top )
+      top = rec->rank;
+     }
+    }
+
+  if( ! remain )  // all sources have been reached
+   break;
+  }
+ }  // end( scan_bucket_par )
+
+/*--------------------------------------------------------------------------*/
+
+template< class FT , class CT >
+BOOL CS2T< FT , CT >::relabel( node_st *i )
 {
  // If i is "active" and for each arc (i, j) in the forward star of i the
  // reduced cost is >= 0, then update the price of i. If some reduced cost
  // in the forward star is negative then the method ends.
 
- CNumber p_max = PRICE_MIN; 
- CNumber i_price = i->price;
+ PT p_max = PRICE_MIN< PT >(); 
+ PT i_price = i->price;
 
  // scan first half of the arcs - - - - - - - - - - - - - - - - - - - - - - -
  // scan arcs from i->current upwards
 
- arc_st *a_max;
- for( arc_st *a = i->current , *a_stop = (i + 1)->closed ; ++a < a_stop ; )
-  if( FGTZ( a->r_cap , EpsFlw ) ) {
-   cCNumber dp = a->head->price - a->cost;
-   if( CGT( dp , p_max , EpsCst ) ) {
+ arc_t a_max;
+ for( arc_t a = i->current , a_stop = (i + 1)->closed ; ++a < a_stop ; )
+  if( FGTZ( RCAP( a ) , EPS_FLW() ) ) {
+   const PT dp = HEAD( a )->price - COST( a );
+   if( CGT( dp , p_max , EPS_CST() ) ) {
     if( i_price < dp ) {
      i->current = a;
      return( TRUE );
@@ -1357,12 +2549,15 @@ BOOL CS2::relabel( node_st *i )
 
  // scan second half of the arcs- - - - - - - - - - - - - - - - - - - - - - -
  // if nothing is found from i->current upwards, re-start the search from
- // i->first
-
- for( arc_st *a = i->first , *a_stop = i->current + 1 ; a < a_stop ; a++ )
-  if( FGTZ( a->r_cap , EpsFlw ) ) {
-   cCNumber dp = a->head->price - a->cost;
-   if( CGT( dp , p_max , EpsCst ) ) {
+ // i->first; if the star of i is empty, i->current is the first arc of the
+ // next star, which must not be scanned
+
+ const arc_t a_end = (i + 1)->closed;
+ for( arc_t a = i->first , a_stop = ( i->current < a_end ? i->current + 1 :
+				      a_end ) ; a < a_stop ; a++ )
+  if( FGTZ( RCAP( a ) , EPS_FLW() ) ) {
+   const PT dp = HEAD( a )->price - COST( a );
+   if( CGT( dp , p_max , EPS_CST() ) ) {
     if( i_price < dp ) {
      i->current = a;
      return( TRUE );
@@ -1375,14 +2570,14 @@ BOOL CS2::relabel( node_st *i )
 
  // finishup- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 
- if( p_max > PRICE_MIN ) {            // node can be relabelled
+ if( p_max > PRICE_MIN< PT >() ) {   // node can be relabelled
   i->price = p_max - epsilon;
   i->current = a_max;
   }
  else                                 // node can't be relabelled
   if( i->suspended == i->first )      // and it has no supended arcs
-   if( FETZ( i->excess , EpsDfct ) )  // it has zero excess
-    i->price = PRICE_MIN;             // set its price to - INF
+   if( FETZ( i->excess , EPS_DFCT() ) )  // it has zero excess
+    i->price = PRICE_MIN< PT >();     // set its price to - INF
    else {
     if( n_ref == 1 )  
      status = kUnfeasible;            // the problem is unfeasible
@@ -1403,31 +2598,39 @@ BOOL CS2::relabel( node_st *i )
 
 /*--------------------------------------------------------------------------*/
 
-void CS2::discharge( node_st *i )
+template< class FT , class CT >
+void CS2T< FT , CT >::discharge( node_st *i )
 {
  // Node "i" is active, i.e., its excess is > 0: apply push/relabel
  // operations to i until it becomes inactive.
 
  Increase( n_discharge );
 
- arc_st *a = i->current;
- node_st *j = a->head;
+ // if the star of i is empty, i->current is the first arc of the next star;
+ // then relabel() either finds the problem unfeasible or, if i has some
+ // suspended arcs, asks for a global update
+
+ arc_t a = i->current;
 
- if( ! ( FGTZ( a->r_cap , EpsFlw ) &&
-	 CLT( i->price + a->cost , j->price , EpsCst ) ) ) {
+ if( ( a == (i + 1)->closed ) ||
+     ! ( FGTZ( RCAP( a ) , EPS_FLW() ) &&
+	 CLT( i->price + COST( a ) , HEAD( a )->price , EPS_CST() ) ) ) {
   relabel( i );
   if( status )
    return;
 
   a = i->current;
-  j = a->head;
+  if( a == (i + 1)->closed )
+   return;
   }
 
+ node_st *j = HEAD( a );
+
  // main loop - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
  // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 
  for( long empty_push = 0 ;; ) {
-  cFNumber j_exc = j->excess;
+  const FT j_exc = j->excess;
 
   #if( EPS_FLOW )
    // Important note: with float flows, a balanced node may in fact have a
@@ -1439,9 +2642,9 @@ void CS2::discharge( node_st *i )
    // this case pushing on a balanced node without making it unbalanced has
    // to be treated as pushing on a node with negative excess.
 
-   cFNumber df = min( i->excess , a->r_cap );
+   const FT df = min( i->excess , RCAP( a ) );
 
-   if( ( j_exc >= - EpsDfct ) && ( j_exc + df > EpsDfct ) )
+   if( ( j_exc >= - EPS_DFCT() ) && ( j_exc + df > EPS_DFCT() ) )
   #else
    if( j_exc >= 0 )
   #endif
@@ -1450,10 +2653,10 @@ void CS2::discharge( node_st *i )
    // this is a "bad" situation, unless is it easy to push the flow out of j,
    // too, so check if it is the case
 
-   arc_st *b = j->current;
+   arc_t b = j->current;
 
-   if( ( FGTZ( b->r_cap , EpsFlw ) &&
-	 CLT( j->price + b->cost , b->head->price , EpsCst ) )
+   if( ( ( b != (j + 1)->closed ) && FGTZ( RCAP( b ) , EPS_FLW() ) &&
+	 CLT( j->price + COST( b ) , HEAD( b )->price , EPS_CST() ) )
        || relabel( j ) )
    {
     // "good" case: it is possible to push flow out of j
@@ -1462,15 +2665,15 @@ void CS2::discharge( node_st *i )
      return;
 
     #if( ! EPS_FLOW )
-     cFNumber df = min( i->excess , a->r_cap );
+     const FT df = min( i->excess , RCAP( a ) );
     #endif
-    if( FETZ( j_exc , EpsDfct ) )  // it was a balanced node
+    if( FETZ( j_exc , EPS_DFCT() ) )  // it was a balanced node
      n_src++;                      // but it is no longer so
 
     INCREASE_FLOW( i , j , a , df );
     Increase( n_push );
 
-    if( j->q_next == sentinel_node )
+    if( j->q_next == LINK( sentinel_node ) )
      INSERT_TO_EXCESS_Q( j );
     }
    else {
@@ -1480,12 +2683,12 @@ void CS2::discharge( node_st *i )
     if( status )  // problem unfeasible or error (in relabel)
      return;
 
-    arc_st *ra = a->sister;
-    cFNumber rdf = min( j->excess , ra->r_cap );
-    if( FGTZ( rdf , EpsFlw ) ) {
+    arc_t ra = SISTER( a );
+    const FT rdf = min( j->excess , RCAP( ra ) );
+    if( FGTZ( rdf , EPS_FLW() ) ) {
      INCREASE_FLOW( j , i , ra , rdf );
      Increase( n_push );
-     if( FETZ( j->excess , EpsDfct ) )
+     if( FETZ( j->excess , EPS_DFCT() ) )
       n_src--;
      }
 
@@ -1497,13 +2700,13 @@ void CS2::discharge( node_st *i )
    }
   else {  // pushing flow to a node with negative excess- - - - - - - - - - -
    #if( ! EPS_FLOW )
-    cFNumber df = min( i->excess , a->r_cap );
+    const FT df = min( i->excess , RCAP( a ) );
    #endif
    INCREASE_FLOW( i , j , a , df );
    Increase( n_push );
 
-   cFNumber new_j_exc = j->excess;      // the new excess of j
-   if( FGTZ( new_j_exc , EpsDfct ) ) {  // ... is positive
+   const FT new_j_exc = j->excess;      // the new excess of j
+   if( FGTZ( new_j_exc , EPS_DFCT() ) ) {  // ... is positive
     n_src++;
     relabel( j );
     if( status )
@@ -1517,7 +2720,7 @@ void CS2::discharge( node_st *i )
 
    }  // end( else( pushing flow to a node with negative excess ) )- - - - - -
 
-  if( FLEZ( i->excess ,  EpsDfct ) ) {
+  if( FLEZ( i->excess ,  EPS_DFCT() ) ) {
    n_src--;
    break;
    }
@@ -1530,7 +2733,7 @@ void CS2::discharge( node_st *i )
    return;
 
   a = i->current;
-  j = a->head;
+  j = HEAD( a );
  
   }  // end( main loop )- - - - - - - - - - - - - - - - - - - - - - - - - - -
      // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -1541,37 +2744,45 @@ void CS2::discharge( node_st *i )
 
 /*--------------------------------------------------------------------------*/
 
-Index CS2::price_in( void )
+template< class FT , class CT >
+Index CS2T< FT , CT >::price_in( void )
 {
  // send flow through arcs with positive residual capacity and negative
  // reduced cost, update active nodes queue at the end.
 
+ tr_guard tg( this , kTrPriceIn );
+
  BOOL bad_found = FALSE;  // TRUE <=> we are at the second scan
  Index n_in_bad = 0;      // number of priced_in arcs with negative reduced
                           // cost
  restart:
 
+ // the suspended arcs are scanned backwards; a is decremented at the top
+ // of the loop, as with CS2_SOA_ARCS arc_t is unsigned and the suspended
+ // arcs of the first node may start at 0
+
  for( node_st *i = nodes ; ++i < sentinel_node ; )
-  for( arc_st *a = i->first , *a_stop = i->suspended ; --a >= a_stop ; ) {
-   cCNumber rc = REDUCED_COST( i , a->head , a );
+  for( arc_t a = i->first , a_stop = i->suspended ; a > a_stop ; ) {
+   --a;
+   const PT rc = REDUCED_COST( i , HEAD( a ) , a );
 
-   if( CLTZ( rc , EpsCst ) && FGTZ( a->r_cap , EpsFlw ) ) {  // bad case
+   if( CLTZ( rc , EPS_CST() ) && FGTZ( RCAP( a ) , EPS_FLW() ) ) {  // bad case
     if( ! bad_found ) {
      bad_found = TRUE;
      UPDATE_CUT_OFF();
      goto restart;
      }
 
-    INCREASE_FLOW( i , a->head , a , a->r_cap );
+    INCREASE_FLOW( i , HEAD( a ) , a , RCAP( a ) );
 
-    arc_st *ra = a->sister;
-    node_st *j = a->head;
+    arc_t ra = SISTER( a );
+    node_st *j = HEAD( a );
 
-    arc_st *b = --( i->first );
+    arc_t b = --( i->first );
     EXCHANGE( a , b );
 
     if( SUSPENDED( j , ra ) ) {
-     arc_st *rb = --( j->first );
+     arc_t rb = --( j->first );
      EXCHANGE( ra , rb );
      }
 
@@ -1579,7 +2790,7 @@ Index CS2::price_in( void )
     }
    else  // good case
     if( ( rc < cut_on ) && ( rc > -cut_on ) ) {
-     arc_st *b = --(i->first);
+     arc_t b = --(i->first);
      EXCHANGE( a , b );
      }
    }
@@ -1592,8 +2803,8 @@ Index CS2::price_in( void )
 
   for( node_st *i = nodes ; ++i < sentinel_node ; ) {
    i->current = i->first;
-   cFNumber i_exc = i->excess;
-   if( FGTZ( i_exc , EpsDfct ) ) {  // i is a source
+   const FT i_exc = i->excess;
+   if( FGTZ( i_exc , EPS_DFCT() ) ) {  // i is a source
     n_src++;
     total_excess += i_exc;
     INSERT_TO_EXCESS_Q( i );
@@ -1603,11 +2814,11 @@ Index CS2::price_in( void )
   INSERT_TO_EXCESS_Q( nodes );  // nodes[ 0 ] is a dummy node
   }
 
- if( time_for_price_in == TIME_FOR_PRICE_IN2 )
-  time_for_price_in = TIME_FOR_PRICE_IN3;
+ if( time_for_price_in == Par.TimeForPriceIn2 )
+  time_for_price_in = Par.TimeForPriceIn3;
 
- if( time_for_price_in == TIME_FOR_PRICE_IN1 )
-  time_for_price_in = TIME_FOR_PRICE_IN2;
+ if( time_for_price_in == Par.TimeForPriceIn1 )
+  time_for_price_in = Par.TimeForPriceIn2;
 
  return( n_in_bad );
 
@@ -1615,19 +2826,21 @@ Index CS2::price_in( void )
 
 /*--------------------------------------------------------------------------*/
 
-void CS2::refine( void )
+template< class FT , class CT >
+void CS2T< FT , CT >::refine( void )
 {
  // while there exist a push or a relabel operation that applies, select one
  // such operation and apply it - - - - - - - - - - - - - - - - - - - - - - -
 
  Increase( n_refine );
  n_ref++;
+ tr_guard tg( this , kTrRefine );
  n_rel = 0;
  n_src = 0;
 
  RESET_EXCESS_Q();
 
- time_for_price_in = TIME_FOR_PRICE_IN1;
+ time_for_price_in = Par.TimeForPriceIn1;
 
  // initialize the queue of excess nodes- - - - - - - - - - - - - - - - - - -
 
@@ -1635,8 +2848,8 @@ void CS2::refine( void )
 
  for( node_st *i = nodes ; ++i < sentinel_node ; ) {
   i->current = i->first;
-  cFNumber i_exc = i->excess;
-  if( FGTZ( i_exc , EpsDfct ) ) {  // i is a source
+  const FT i_exc = i->excess;
+  if( FGTZ( i_exc , EPS_DFCT() ) ) {  // i is a source
    n_src++;
    total_excess += i_exc;
    INSERT_TO_EXCESS_Q( i );
@@ -1651,8 +2864,20 @@ void CS2::refine( void )
  char pr_in_int = 0;   // current number of update between price_in
 
  for(;;) {
+  if( ( rf_mode == kWaveRefine ) && ( n_src >= RF_WAVE_MIN ) ) {
+   wave();
+   if( status )   // problem unfeasible or error
+    return;
+
+   if( ( n_rel > n * Par.UpdtFreq + n_src * Par.UpdtFreqS ) || flag_price )
+    if( global_update( pr_in_int ) )
+     return;
+
+   continue;
+   }
+
   if( ! excq_first ) {
-   if( n_ref > PRICE_OUT_START )
+   if( n_ref > Par.PriceOutStart )
     price_in();
 
    if( ! excq_first )
@@ -1662,57 +2887,237 @@ void CS2::refine( void )
   node_st *i;
   REMOVE_FROM_EXCESS_Q( i );
 
-  if( FGTZ( i->excess , EpsDfct ) ) {  // try to push all excess out of i
+  if( FGTZ( i->excess , EPS_DFCT() ) ) {  // try to push all excess out of i
    discharge( i );
    if( status )   // problem unfeasible or error
     return;
 
-   // number of relabel is greather than  number of nodes * UPDT_FREQ  +
-   // current number of source nodes * UPDT_FREQ_S - - - - - - - - - - -
+   // number of relabel is greather than  number of nodes * UpdtFreq  +
+   // current number of source nodes * UpdtFreqS - - - - - - - - - - - - - -
 
-   if( ( n_rel > n * UPDT_FREQ + n_src * UPDT_FREQ_S ) || flag_price ) {
-    if( FGTZ( i->excess , EpsDfct ) )
+   if( ( n_rel > n * Par.UpdtFreq + n_src * Par.UpdtFreqS ) || flag_price ) {
+    if( FGTZ( i->excess , EPS_DFCT() ) )
      INSERT_TO_EXCESS_Q( i );
 
-    if( flag_price && ( n_ref > PRICE_OUT_START ) ) {
-     pr_in_int = 0;
-     price_in();
-     flag_price = FALSE;
+    if( global_update( pr_in_int ) )
+     return;
+    }  // time for update
+   }
+  }  // end of main loop
+ }  // end( refine ) 
+
+/*--------------------------------------------------------------------------*/
+
+template< class FT , class CT >
+BOOL CS2T< FT , CT >::global_update( char &pr_in_int )
+{
+ if( flag_price && ( n_ref > Par.PriceOutStart ) ) {
+  pr_in_int = 0;
+  price_in();
+  flag_price = FALSE;
+  }
+
+ while( price_update() )
+  if( n_ref == 1 ) {
+   status = kUnfeasible;
+   return( TRUE );
+   }
+  else {
+   UPDATE_CUT_OFF();
+   n_bad_relabel++;
+   pr_in_int = 0;
+   price_in();
+   }
+
+ n_rel = 0;
+
+ if( ( n_ref > Par.PriceOutStart ) && ( pr_in_int++ > time_for_price_in ) ) {
+  pr_in_int = 0;
+  price_in();
+  }
+
+ return( FALSE );
+
+ }  // end( global_update )
+
+/*--------------------------------------------------------------------------*/
+
+template< class FT , class CT >
+void CS2T< FT , CT >::wave( void )
+{
+ // A synchronous (Jacobi-like) version of discharge(), applied to all the
+ // active nodes at once. In the first step, each active node pushes its
+ // excess (as it was at the start of the wave) along the admissible arcs
+ // from its current arc on. The prices do not change during this step, so
+ // that if an arc is admissible its sister is not: every arc is written by
+ // the only node that can push along it, and the sisters of admissible arcs
+ // are never read. Only the excesses of the nodes receiving flow are shared,
+ // and they are updated atomically. In the second step, the nodes that have
+ // run out of admissible arcs with some excess left compute their new price
+ // and current arc from the prices before the wave, and in the third they
+ // set them: as prices only decrease, relabelling two adjacent nodes at the
+ // same time keeps the flow epsilon-optimal. The few nodes that cannot be
+ // relabelled (because of suspended arcs, or unfeasibility) are left to
+ // relabel(), and the excess queue is finally rebuilt from the nodes of
+ // the wave and those they pushed to.
+
+ // move the active nodes to rf_nds[]- - - - - - - - - - - - - - - - - - - -
+ // each one has room in rf_rcv[] for one head per arc it may push along
+
+ if( ! rf_nds )
+  rf_nds = new wave_st[ nmax ];
+
+ Increase( n_wave );
+
+ Index na = 0;
+ Index nr = 0;
+ while( excq_first ) {
+  node_st *i;
+  REMOVE_FROM_EXCESS_Q( i );
+
+  if( FGTZ( i->excess , EPS_DFCT() ) ) {
+   Increase( n_discharge );
+   wave_st *w = rf_nds + na++;
+   w->node = i;
+   w->exc = i->excess;
+   w->rcv = nr;
+   arc_t a_stop = (i + 1)->closed;
+   if( a_stop > i->current )
+    nr += ARC_NUM( a_stop ) - ARC_NUM( i->current );
+   }
+  }
+
+ if( nr > rf_rsize ) {
+  delete[] rf_rcv;
+  rf_rsize = nr;
+  rf_rcv = new node_st*[ rf_rsize ];
+  }
+
+ const int nw = int( na );
+
+ #pragma omp parallel num_threads( int( rf_thrds ) )
+ {
+  // push- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+  #pragma omp for schedule( dynamic , 64 )
+  for( int k = 0 ; k < nw ; k++ ) {
+   wave_st *w = rf_nds + k;
+   node_st *i = w->node;
+   node_st **rcv = rf_rcv + w->rcv;
+   FT e = w->exc;
+
+   arc_t a = i->current;
+   for( arc_t a_stop = (i + 1)->closed ; a < a_stop ; a++ ) {
+    node_st *j = HEAD( a );
+    if( CLT( i->price + COST( a ) , j->price , EPS_CST() ) &&
+	FGTZ( RCAP( a ) , EPS_FLW() ) ) {
+     const FT df = min( e , RCAP( a ) );
+     RCAP( a ) -= df;
+     RCAP( SISTER( a ) ) += df;
+     #pragma omp atomic
+     j->excess += df;
+
+     *(rcv++) = j;
+     e -= df;
+     if( FLEZ( e , EPS_DFCT() ) )
+      break;
      }
+    }
 
-    while( price_update() )
-     if( n_ref == 1 ) {
-      status = kUnfeasible;
-      return;
-      }
-     else {
-      UPDATE_CUT_OFF();
-      n_bad_relabel++;
-      pr_in_int = 0;
-      price_in();
-      }
+   const FT df = w->exc - e;
+   #pragma omp atomic
+   i->excess -= df;
+
+   w->rcv_stop = Index( rcv - rf_rcv );
+   w->relab = ( a == (i + 1)->closed );
+   if( ! w->relab )
+    i->current = a;
+   }
 
-    n_rel = 0;
+  // compute the new prices - - - - - - - - - - - - - - - - - - - - - - - - -
 
-    if( ( n_ref > PRICE_OUT_START ) && ( pr_in_int++ > time_for_price_in ) )
-    {
-     pr_in_int = 0;
-     price_in();
+  #pragma omp for schedule( dynamic , 64 )
+  for( int k = 0 ; k < nw ; k++ ) {
+   wave_st *w = rf_nds + k;
+   if( ! w->relab )
+    continue;
+
+   node_st *i = w->node;
+   PT p_max = PRICE_MIN< PT >();
+   arc_t a_max = i->first;
+   for( arc_t a = i->first , a_stop = (i + 1)->closed ; a < a_stop ; a++ )
+    if( FGTZ( RCAP( a ) , EPS_FLW() ) ) {
+     const PT dp = HEAD( a )->price - COST( a );
+     if( CGT( dp , p_max , EPS_CST() ) ) {
+      p_max = dp;
+      a_max = a;
+      }
      }
-    }  // time for update
+
+   w->price = p_max;
+   w->cur = a_max;
+   }
+
+  // set them- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+  #pragma omp for
+  for( int k = 0 ; k < nw ; k++ ) {
+   wave_st *w = rf_nds + k;
+   if( w->relab && ( w->price > PRICE_MIN< PT >() ) ) {
+    w->node->price = w->price - epsilon;
+    w->node->current = w->cur;
+    }
+   }
+  }  // end( omp parallel )
+
+ // count the relabels, and rebuild the excess queue- - - - - - - - - - - - -
+
+ n_src = 0;
+ for( Index k = 0 ; k < na ; k++ ) {
+  wave_st *w = rf_nds + k;
+  node_st *i = w->node;
+
+  if( w->relab ) {
+   if( w->price > PRICE_MIN< PT >() ) {
+    Increase( n_relabel );
+    n_rel++;
+    }
+   else {
+    relabel( i );
+    if( status )
+     return;
+    }
+   }
+
+  if( FGTZ( i->excess , EPS_DFCT() ) &&
+      ( i->q_next == LINK( sentinel_node ) ) ) {
+   INSERT_TO_EXCESS_Q( i );
+   n_src++;
    }
-  }  // end of main loop
- }  // end( refine ) 
+
+  for( node_st **j = rf_rcv + w->rcv , **j_stop = rf_rcv + w->rcv_stop ;
+       j < j_stop ; j++ ) {
+   Increase( n_push );
+   if( FGTZ( (*j)->excess , EPS_DFCT() ) &&
+       ( (*j)->q_next == LINK( sentinel_node ) ) ) {
+    INSERT_TO_EXCESS_Q( *j );
+    n_src++;
+    }
+   }
+  }
+ }  // end( wave )
 
 /*--------------------------------------------------------------------------*/
 
-BOOL CS2::price_refine( void )
+template< class FT , class CT >
+BOOL CS2T< FT , CT >::price_refine( void )
 {
  // this euristic decreases epsilon and do not change the flow f while
  // modifyng the potentials in an attempt to find a potential p such that f
  // is epsilon-optimal with respect to p
 
  Increase( n_prefine );
+ tr_guard tg( this , kTrPriceRefine );
 
  BOOL cc = TRUE;  // return value: TRUE if flow is epsilon optimal, FALSE if
                   // refine is needed
@@ -1738,21 +3143,21 @@ BOOL CS2::price_refine( void )
    if( i->inp == BLACK )
     continue;
 
-   i->b_next = NULL;
+   i->b_next = LINK( NULL );
 
    for(;;) {  // depth first search
     i->inp = GREY;
 
     // scanning arcs from node i starting from current
 
-    arc_st *a = i->current , *a_stop = (i + 1)->closed;
+    arc_t a = i->current , a_stop = (i + 1)->closed;
     for( ; a < a_stop ; a++ )
-     if( FGTZ( a->r_cap , EpsFlw ) ) {
-      node_st *j = a->head;
-      if( CLTZ( REDUCED_COST( i , j , a ) , EpsCst ) ) {
+     if( FGTZ( RCAP( a ) , EPS_FLW() ) ) {
+      node_st *j = HEAD( a );
+      if( CLTZ( REDUCED_COST( i , j , a ) , EPS_CST() ) ) {
        if( j->inp == WHITE ) {  // fresh node - step forward
 	i->current = a;
-	j->b_next  = i;
+	j->b_next  = LINK( i );
 	i = j;
 	a = j->current;
 	a_stop = (j + 1)->closed;
@@ -1766,12 +3171,12 @@ BOOL CS2::price_refine( void )
 	i->current = a;
 	node_st *is = i;
 	node_st *ir = i;
-	FNumber df = F_INF;
+	FT df = std::numeric_limits< FT >::max();
 
-	for(;; ir = ir->b_next ) {
-	 arc_st * ar = ir->current;
-	 if( ar->r_cap <= df ) {
-	  df = ar->r_cap;
+	for(;; ir = NODE( ir->b_next ) ) {
+	 arc_t ar = ir->current;
+	 if( RCAP( ar ) <= df ) {
+	  df = RCAP( ar );
 	  is = ir;
 	  }
 
@@ -1779,16 +3184,16 @@ BOOL CS2::price_refine( void )
 	  break;
 	 }
 
-	for( ir = i ;; ir = ir->b_next ) {
-	 arc_st * ar = ir->current;
-	 INCREASE_FLOW( ir , ar->head , ar , df );
+	for( ir = i ;; ir = NODE( ir->b_next ) ) {
+	 arc_t ar = ir->current;
+	 INCREASE_FLOW( ir , HEAD( ar ) , ar , df );
 
 	 if( ir == j )
 	  break;
 	 }
 
 	if( is != i ) {
-	 for( ir = i ; ir != is ; ir = ir->b_next )
+	 for( ir = i ; ir != is ; ir = NODE( ir->b_next ) )
 	  ir->inp = WHITE;
 
 	 i = is;
@@ -1806,7 +3211,7 @@ BOOL CS2::price_refine( void )
     if( a == a_stop ) {
      Increase( n_prscan1 );
      i->inp = BLACK;  // step back
-     node_st *j = i->b_next;
+     node_st *j = NODE( i->b_next );
      STACKQ_PUSH( i );
 
      if( j == NULL )
@@ -1834,20 +3239,19 @@ BOOL CS2::price_refine( void )
    REMOVE_FROM_EXCESS_Q( i );
 
    SIndex i_rank = i->rank;
-   for( arc_st *a = i->first , *a_stop = (i + 1)->closed ; a < a_stop ; a++ )
-    if( FGTZ( a->r_cap , EpsFlw ) ) {
-     node_st *j = a->head;
-     cCNumber rc = REDUCED_COST( i , j , a );
-
-     if( CLTZ( rc , EpsCst ) ) {  // admissible arc
-      #if( Ctype == REAL_TYPE )
-       cSIndex dr = SIndex( ( - rc - CNumber( 0.5 )  ) / epsilon );
-      #else
-       cSIndex dr = SIndex( ( - rc - CNumber( 1 ) ) / epsilon );
-      #endif
-      cSIndex j_rank = dr + i_rank;
-      if( ( j_rank < linf ) && ( j_rank > j->rank ) )
-       j->rank = j_rank;
+   for( arc_t a = i->first , a_stop = (i + 1)->closed ; a < a_stop ; a++ )
+    if( FGTZ( RCAP( a ) , EPS_FLW() ) ) {
+     node_st *j = HEAD( a );
+     const PT rc = REDUCED_COST( i , j , a );
+
+     if( CLTZ( rc , EPS_CST() ) ) {  // admissible arc
+      const PT dr = ( - rc - ( IntCst ? PT( 1 ) : PT( 0.5 ) ) ) / epsilon;
+      cSIndex j_rank = ( dr < linf ? SIndex( dr ) + i_rank : linf );
+      if( j_rank >= linf )  // too far for the buckets, as it can be after
+       cc = FALSE;          // the first refine() if n < ScaleFactor: the
+      else                  // arc is saturated below
+       if( j_rank > j->rank )
+        j->rank = j_rank;
       }
      }
 
@@ -1855,7 +3259,7 @@ BOOL CS2::price_refine( void )
     if( i_rank > bmax )
      bmax = i_rank;
 
-    INSERT_TO_BUCKET( i , buckets + i_rank );
+    INSERT_TO_BUCKET( i , BUCKET( i_rank ) );
     }
    }  // end( while )
 
@@ -1864,25 +3268,25 @@ BOOL CS2::price_refine( void )
 
   for( bucket_st *b = buckets + bmax ; b > buckets ; b-- ) {
    SIndex i_rank = b - buckets;
-   cCNumber dp = CNumber( i_rank * epsilon );
+   const PT dp = PT( i_rank * epsilon );
 
    while( NONEMPTY_BUCKET( b ) ) {
     node_st *i;
     GET_FROM_BUCKET ( i, b );
 
     Increase( n_prscan );
-    for( arc_st *a = i->first , *a_stop = (i + 1)->closed ; a < a_stop ; a++ )
-     if( FGTZ( a->r_cap , EpsFlw ) ) {
-      node_st *j = a->head;
+    for( arc_t a = i->first , a_stop = (i + 1)->closed ; a < a_stop ; a++ )
+     if( FGTZ( RCAP( a ) , EPS_FLW() ) ) {
+      node_st *j = HEAD( a );
       SIndex j_rank = j->rank;
       if( j_rank < i_rank ) {
        SIndex j_new_rank;
-       cCNumber rc = REDUCED_COST( i , j , a );
-       if( CLTZ( rc , EpsCst ) )
+       const PT rc = REDUCED_COST( i , j , a );
+       if( CLTZ( rc , EPS_CST() ) )
         j_new_rank = i_rank;
        else {
-        SIndex dr = SIndex( rc / epsilon );
-        j_new_rank = ( dr < linf ? i_rank - dr - 1 : 0 );
+        const PT dr = rc / epsilon;
+        j_new_rank = ( dr < linf ? i_rank - SIndex( dr ) - 1 : 0 );
         }
 
        if( j_rank < j_new_rank ) {
@@ -1895,7 +3299,7 @@ BOOL CS2::price_refine( void )
 	 INSERT_TO_BUCKET( j , buckets + j_new_rank );
          }
         else
-	 INCREASE_FLOW( i , j , a , a->r_cap );
+	 INCREASE_FLOW( i , j , a , RCAP( a ) );
         }
        }
       }
@@ -1915,10 +3319,10 @@ BOOL CS2::price_refine( void )
 
  if( ! cc )
   for( node_st *i = nodes ; ++i < sentinel_node ; )
-   for( arc_st *a = i->first , *a_stop = (i + 1)->closed ; a < a_stop ; a++ )
-    if( REDUCED_COST( i , a->head , a ) < - epsilon )
-     if( FGTZ( a->r_cap , EpsFlw ) )
-      INCREASE_FLOW( i , a->head , a , a->r_cap );
+   for( arc_t a = i->first , a_stop = (i + 1)->closed ; a < a_stop ; a++ )
+    if( REDUCED_COST( i , HEAD( a ) , a ) < - epsilon )
+     if( FGTZ( RCAP( a ) , EPS_FLW() ) )
+      INCREASE_FLOW( i , HEAD( a ) , a , RCAP( a ) );
 
  return( cc );
 
@@ -1928,9 +3332,11 @@ BOOL CS2::price_refine( void )
 
 #if( COMP_DUALS )
 
-void CS2::compute_prices( void )
+template< class FT , class CT >
+void CS2T< FT , CT >::compute_prices( void )
 {
  Increase( n_prefine );
+ tr_guard tg( this , kTrComputePrices );
 
  BOOL cc = TRUE;  // TRUE = flow is epsilon optimal, FALSE = refine is needed
 
@@ -1952,21 +3358,21 @@ void CS2::compute_prices( void )
    if( i->inp == BLACK )
     continue;
 
-   i->b_next = NULL;
+   i->b_next = LINK( NULL );
 
    for(;;) {  // depth first search
     i->inp = GREY;
 
     // scanning arcs from node i
-    arc_st *a = i->first , *a_stop = (i + 1)->closed;
+    arc_t a = i->first , a_stop = (i + 1)->closed;
 
     for(  ; a < a_stop ; a++ )
-     if( FGTZ( a->r_cap , EpsFlw ) ) {
-      node_st *j = a->head;
-      if( CLTZ( REDUCED_COST( i , j , a ) , EpsCst ) ) {
+     if( FGTZ( RCAP( a ) , EPS_FLW() ) ) {
+      node_st *j = HEAD( a );
+      if( CLTZ( REDUCED_COST( i , j , a ) , EPS_CST() ) ) {
        if( j->inp == WHITE ) {  // fresh node - step forward
 	i->current = a;
-	j->b_next  = i;
+	j->b_next  = LINK( i );
 	i = j;
 	a = j->current;
 	a_stop = (j + 1)->closed;
@@ -1984,7 +3390,7 @@ void CS2::compute_prices( void )
      i->inp = BLACK;
      Increase( n_prscan1 );
 
-     node_st *j = i->b_next;
+     node_st *j = NODE( i->b_next );
      STACKQ_PUSH( i );
 
      if( j == NULL )
@@ -2008,12 +3414,12 @@ void CS2::compute_prices( void )
    REMOVE_FROM_EXCESS_Q( i );
 
    SIndex i_rank = i->rank;
-   for( arc_st *a = i->first , *a_stop = (i + 1)->closed ; a < a_stop ; a++ )
-    if ( FGTZ( a->r_cap , EpsFlw ) ) {
-     node_st *j = a->head;
-     cCNumber rc = REDUCED_COST( i , j , a );
+   for( arc_t a = i->first , a_stop = (i + 1)->closed ; a < a_stop ; a++ )
+    if ( FGTZ( RCAP( a ) , EPS_FLW() ) ) {
+     node_st *j = HEAD( a );
+     const PT rc = REDUCED_COST( i , j , a );
 
-     if( CLTZ( rc , EpsCst ) ) {  // admissible arc
+     if( CLTZ( rc , EPS_CST() ) ) {  // admissible arc
       SIndex j_rank = SIndex( - rc ) + i_rank;
       if( j_rank < linf )
        if( j_rank > j->rank )
@@ -2025,7 +3431,7 @@ void CS2::compute_prices( void )
     if( i_rank > bmax )
      bmax = i_rank;
 
-    INSERT_TO_BUCKET( i , buckets + i_rank );
+    INSERT_TO_BUCKET( i , BUCKET( i_rank ) );
     }
    }  // end( while )
 
@@ -2034,28 +3440,28 @@ void CS2::compute_prices( void )
 
   for( bucket_st *b = buckets + bmax ; b > buckets ; b-- ) {
    SIndex i_rank = b - buckets;
-   cCNumber dp = CNumber( i_rank );
+   const PT dp = PT( i_rank );
 
    while( NONEMPTY_BUCKET( b ) ) {
     GET_FROM_BUCKET ( i, b );
 
     Increase( n_prscan );
 
-    for( arc_st *a = i->first , *a_stop = (i + 1)->closed ; a < a_stop ;
+    for( arc_t a = i->first , a_stop = (i + 1)->closed ; a < a_stop ;
 	 a++ )
-     if( FGTZ( a->r_cap , EpsFlw ) ) {
-      node_st *j = a->head;
+     if( FGTZ( RCAP( a ) , EPS_FLW() ) ) {
+      node_st *j = HEAD( a );
       SIndex j_rank = j->rank;
 
       if( j_rank < i_rank ) {
        SIndex j_new_rank;
-       cCNumber rc = REDUCED_COST( i , j , a );
+       const PT rc = REDUCED_COST( i , j , a );
 
-       if( CLTZ( rc , EpsCst ) )
+       if( CLTZ( rc , EPS_CST() ) )
 	j_new_rank = i_rank;
        else {
-	SIndex dr = SIndex( rc );
-        j_new_rank = ( dr < linf ? i_rank - dr - 1 : 0 );
+	const PT dr = rc;
+        j_new_rank = ( dr < linf ? i_rank - SIndex( dr ) - 1 : 0 );
         }
 
        if( j_rank < j_new_rank )
@@ -2086,23 +3492,28 @@ void CS2::compute_prices( void )
 
 /*--------------------------------------------------------------------------*/
 
-void CS2::price_out( void )
+template< class FT , class CT >
+void CS2T< FT , CT >::price_out( void )
 {
  // suspend arcs having positive reduced cost and zero flow and arcs having
  // negative reduced costs and closed.  
 
- cCNumber n_cut_off = - cut_off;
+ tr_guard tg( this , kTrPriceOut );
+
+ const PT n_cut_off = - cut_off;
 
  for( node_st *i = nodes ; ++i < sentinel_node ; )
-  for( arc_st *a = i->first , *a_stop = (i + 1)->closed ; a < a_stop ; a++ )
+  for( arc_t a = i->first , a_stop = (i + 1)->closed ; a < a_stop ; a++ )
   {
-   cCNumber rc = REDUCED_COST( i , a->head , a );
+   const PT rc = REDUCED_COST( i , HEAD( a ) , a );
 
-   if( ( CGT( rc , cut_off , EpsCst ) && FLEZ( a->sister->r_cap , EpsFlw ) )
+   if( ( CGT( rc , cut_off , EPS_CST() ) &&
+	 FLEZ( RCAP( SISTER( a ) ) , EPS_FLW() ) )
        ||
-       ( CLT( rc , n_cut_off , EpsCst ) && FLEZ( a->r_cap , EpsFlw ) ) )
+       ( CLT( rc , n_cut_off , EPS_CST() ) &&
+	 FLEZ( RCAP( a ) , EPS_FLW() ) ) )
    {
-    arc_st *b = (i->first)++;  // suspend the arc
+    arc_t b = (i->first)++;  // suspend the arc
     EXCHANGE( a , b );
     }
    }
@@ -2111,22 +3522,19 @@ void CS2::price_out( void )
 
 /*--------------------------------------------------------------------------*/
 
-inline BOOL CS2::update_epsilon( void )
+template< class FT , class CT >
+inline BOOL CS2T< FT , CT >::update_epsilon( void )
 {
- // decrease epsilon of a value dependent from SCALE_DEFAULT after that an
- // epsilon-optimal flow is constructed
+ // decrease epsilon of a value dependent from Par.ScaleFactor after that
+ // an epsilon-optimal flow is constructed
 
- if( epsilon <= LOW_BOUND )
+ if( epsilon <= LOW_BOUND< PT >() )
   return( TRUE );
  else {
-  #if( Ctype == REAL_TYPE  )
-   epsilon = ceil( epsilon / SCALE_DEFAULT );
-  #else
-   epsilon = epsilon / SCALE_DEFAULT + ( epsilon % SCALE_DEFAULT ? 1 : 0 );
-  #endif
+  epsilon = CEIL_DIV( epsilon , PT( Par.ScaleFactor ) );
 
-  cut_off = CNumber( cut_off_factor ) * epsilon;
-  cut_on = cut_off * CNumber( CUT_OFF_GAP );
+  cut_off = PT( cut_off_factor * epsilon );
+  cut_on = PT( cut_off * Par.CutOffGap );
 
   return( FALSE );
   }
@@ -2134,127 +3542,264 @@ inline BOOL CS2::update_epsilon( void )
 
 /*--------------------------------------------------------------------------*/
 
-inline CNumber CS2::REDUCED_COST( const node_st *i , const node_st *j ,
-				  const arc_st *a )
+template< class FT , class CT >
+inline typename CS2T< FT , CT >::PT
+ CS2T< FT , CT >::REDUCED_COST( const node_st *i , const node_st *j ,
+				const arc_t a )
 {
- return( i->price + a->cost - j->price );
+ return( i->price + COST( a ) - j->price );
  }
 
 /*--------------------------------------------------------------------------*/
 
-inline BOOL CS2::SUSPENDED( const node_st *i , const arc_st *a )
+template< class FT , class CT >
+inline BOOL CS2T< FT , CT >::SUSPENDED( const node_st *i , const arc_t a )
 {
  return( a < i->first && a >= i->closed);
  }
 
 /*--------------------------------------------------------------------------*/
 
-inline void CS2::EXCHANGE( arc_st *a , arc_st *b )
+template< class FT , class CT >
+inline void CS2T< FT , CT >::EXCHANGE( arc_t a , arc_t b )
 {
  if( a != b ) {
-  arc_st *sa = a->sister;
-  arc_st *sb = b->sister;
-
-  Swap( a->head , b->head );
-  Swap( a->cost , b->cost );
-  Swap( a->r_cap , b->r_cap );
-  Swap( a->position , b->position );
-
-  if( a != sb ) {
-   b->sister = sa;
-   a->sister = sb;
-   sa->sister = b;
-   sb->sister = a;
-   }
+  node_st *ha = HEAD( a );
+  SET_HEAD( a , HEAD( b ) );
+  SET_HEAD( b , ha );
+  Swap( COST( a ) , COST( b ) );
+  Swap( RCAP( a ) , RCAP( b ) );
+  Swap( POSITION( a ) , POSITION( b ) );
+
+  #if( CS2_INDEX_LINKS )
+   // the sisters are only recorded in pos[], where the two arcs just have
+   // to be moved to their new positions
+
+   cSIndex pa = POSITION( a );
+   pos[ pa > 0 ? pa - 1 : mmax - pa - 1 ] = a;
+
+   cSIndex pb = POSITION( b );
+   pos[ pb > 0 ? pb - 1 : mmax - pb - 1 ] = b;
+  #else
+   arc_t sa = SISTER( a );
+   arc_t sb = SISTER( b );
+
+   if( a != sb ) {
+    SISTER( b ) = sa;
+    SISTER( a ) = sb;
+    SISTER( sa ) = b;
+    SISTER( sb ) = a;
+    }
  
-  if( a->position > 0 )
-   pos[ a->position - 1 ] = a;
+   if( POSITION( a ) > 0 )
+    pos[ POSITION( a ) - 1 ] = a;
 
-  if( b->position > 0 )
-   pos[ b->position - 1 ] = b;
+   if( POSITION( b ) > 0 )
+    pos[ POSITION( b ) - 1 ] = b;
+  #endif
   }
  }  // end( EXCHANGE )
 
 /*--------------------------------------------------------------------------*/
 
-inline void CS2::INCREASE_FLOW( node_st* i , node_st* j , arc_st* a ,
-				cFNumber df )
+template< class FT , class CT >
+inline void CS2T< FT , CT >::INCREASE_FLOW( node_st* i , node_st* j , arc_t a ,
+					    const FT df )
 {
  i->excess        -= df;
  j->excess        += df;
- a->r_cap         -= df;
- a->sister->r_cap += df;
+ RCAP( a )         -= df;
+ RCAP( SISTER( a ) ) += df;
  }
 
 /*--------------------------------------------------------------------------*/
 
-inline void CS2::UPDATE_CUT_OFF( void )
+template< class FT , class CT >
+inline void CS2T< FT , CT >::UPDATE_CUT_OFF( void )
 {
  if( n_bad_pricein + n_bad_relabel )
-  cut_off_factor *= CUT_OFF_INCREASE;
+  cut_off_factor *= Par.CutOffIncrease;
  else {
-  cut_off_factor = CUT_OFF_COEF2 * pow( dn , CUT_OFF_POWER2 );
-  if( cut_off_factor < CUT_OFF_MIN )
-   cut_off_factor = CUT_OFF_MIN;
+  cut_off_factor = Par.CutOffCoef2 * pow( dn , Par.CutOffPower2 );
+  if( cut_off_factor < Par.CutOffMin )
+   cut_off_factor = Par.CutOffMin;
+  }
+
+ cut_off = PT( cut_off_factor * epsilon );
+ cut_on = PT( cut_off * Par.CutOffGap );
+ }
+
+/*--------------------------------------------------------------------------*/
+
+template< class FT , class CT >
+void CS2T< FT , CT >::pt_grow( cIndex len )
+{
+ pt_max = ( pt_max ? 2 * pt_max : 64 );
+
+ arc_t *used = new arc_t[ pt_max ];
+ FT *taken = new FT[ pt_max ];
+ Index_Set node = new Index[ pt_max ];
+ for( Index k = 0 ; k < len ; k++ ) {
+  used[ k ] = pt_used[ k ];
+  taken[ k ] = pt_taken[ k ];
+  node[ k ] = pt_node[ k ];
+  }
+
+ delete[] pt_node;
+ delete[] pt_taken;
+ delete[] pt_used;
+ pt_used = used;
+ pt_taken = taken;
+ pt_node = node;
+
+ }  // end( CS2::pt_grow )
+
+/*--------------------------------------------------------------------------*/
+
+template< class FT , class CT >
+Index CS2T< FT , CT >::tr_begin( char kind )
+{
+ if( tr_size == tr_max ) {
+  tr_max = ( tr_max ? 2 * tr_max : 64 );
+  CS2TrRec *recs = new CS2TrRec[ tr_max ];
+  for( Index k = 0 ; k < tr_size ; k++ )
+   recs[ k ] = tr_recs[ k ];
+
+  delete[] tr_recs;
+  tr_recs = recs;
   }
 
- cut_off = CNumber( cut_off_factor ) * epsilon;
- cut_on = cut_off * CNumber( CUT_OFF_GAP );
+ CS2TrRec *rec = tr_recs + tr_size;
+ rec->Phase = n_ref;
+ rec->Kind = kind;
+ rec->Epsilon = double( epsilon );
+ rec->Start = tr_t->Read();
+ rec->Time = 0;
+
+ return( tr_size++ );
+ }
+
+/*--------------------------------------------------------------------------*/
+
+template< class FT , class CT >
+void CS2T< FT , CT >::tr_end( cIndex k )
+{
+ tr_recs[ k ].Time = tr_t->Read() - tr_recs[ k ].Start;
+ }
+
+/*--------------------------------------------------------------------------*/
+
+template< class FT , class CT >
+inline void CS2T< FT , CT >::reset_stats( void )
+{
+ n_ref = 0;
+ st_time = 0;
+
+ #if( CS2_STATISTICS )
+  n_push = n_relabel = n_discharge = n_refine = n_update = n_scan =
+  n_prscan = n_prscan1 = n_prscan2 = n_prefine = n_wave = 0;
+ #endif
  }
 
 /*--------------------------------------------------------------------------*/
 
-inline void CS2::RESET_EXCESS_Q( void )
+template< class FT , class CT >
+inline void CS2T< FT , CT >::RESET_EXCESS_Q( void )
 {
  for( ; excq_first != NULL ; excq_first = excq_last ) {
-  excq_last = excq_first->q_next;
-  excq_first->q_next = sentinel_node;
+  excq_last = NODE( excq_first->q_next );
+  excq_first->q_next = LINK( sentinel_node );
   }
  }
 
 /*--------------------------------------------------------------------------*/
 
-inline void CS2::INSERT_TO_EXCESS_Q( node_st* i )
+template< class FT , class CT >
+inline void CS2T< FT , CT >::INSERT_TO_EXCESS_Q( node_st* i )
 {
  if( excq_first )
-  excq_last->q_next = i;
+  excq_last->q_next = LINK( i );
  else
   excq_first = i;
 
- i->q_next = NULL;
+ i->q_next = LINK( NULL );
  excq_last = i;
  }
 
 /*--------------------------------------------------------------------------*/
 
-inline void CS2::INSERT_TO_FRONT_EXCESS_Q( node_st* i )
+template< class FT , class CT >
+inline void CS2T< FT , CT >::INSERT_TO_FRONT_EXCESS_Q( node_st* i )
 {
  if( ! excq_first )
   excq_last = i;
 
- i->q_next = excq_first;
+ i->q_next = LINK( excq_first );
  excq_first = i;
  }
 
 /*--------------------------------------------------------------------------*/
 
-inline void CS2::REMOVE_FROM_EXCESS_Q( node_st* &i )
+template< class FT , class CT >
+inline void CS2T< FT , CT >::REMOVE_FROM_EXCESS_Q( node_st* &i )
 {
  i = excq_first;
- excq_first = i->q_next;
- i->q_next = sentinel_node;
+ excq_first = NODE( i->q_next );
+ i->q_next = LINK( sentinel_node );
  }
 
 /*-------------------------------------------------------------------------*/
 
-inline void CS2::RESET_BUCKET( bucket_st *b )
+template< class FT , class CT >
+inline void CS2T< FT , CT >::RESET_BUCKET( bucket_st *b )
 {
  b->p_first = nodes;  // nodes[ 0 ] is a dummy node
  }
 
 /*-------------------------------------------------------------------------*/
 
-inline BOOL CS2::NONEMPTY_BUCKET( bucket_st *b )
+template< class FT , class CT >
+inline typename CS2T< FT , CT >::bucket_st *CS2T< FT , CT >::BUCKET(
+								 cSIndex r )
+{
+ if( Index( r ) >= b_size )
+  grow_buckets( r );
+
+ return( buckets + r );
+ }
+
+/*-------------------------------------------------------------------------*/
+
+template< class FT , class CT >
+void CS2T< FT , CT >::grow_buckets( cSIndex r )
+{
+ // the ranks actually reached are usually a tiny fraction of linf, as they
+ // are bounded by the (scaled) cost range rather than by n: rather than
+ // paying for linf buckets upfront, buckets[] is doubled when needed
+
+ Index nsize = 2 * b_size;
+ if( nsize <= Index( r ) )
+  nsize = Index( r ) + 1;
+ if( nsize > Index( linf ) )
+  nsize = Index( linf );
+
+ bucket_st *nb = new bucket_st[ nsize ];
+ for( Index h = 0 ; h < b_size ; h++ )
+  nb[ h ] = buckets[ h ];
+ for( Index h = b_size ; h < nsize ; h++ )
+  RESET_BUCKET( nb + h );
+
+ if( ! ar.Owns( buckets ) )
+  delete[] buckets;
+
+ buckets = nb;
+ b_size = nsize;
+ }
+
+/*-------------------------------------------------------------------------*/
+
+template< class FT , class CT >
+inline BOOL CS2T< FT , CT >::NONEMPTY_BUCKET( bucket_st *b )
 {
  return( b->p_first != nodes );  // an empty bucket contains only the dummy
                                  // node nodes[ 0 ]
@@ -2262,73 +3807,143 @@ inline BOOL CS2::NONEMPTY_BUCKET( bucket_st *b )
 
 /*--------------------------------------------------------------------------*/
 
-inline void CS2::INSERT_TO_BUCKET( node_st* i , bucket_st* b )
+template< class FT , class CT >
+inline void CS2T< FT , CT >::INSERT_TO_BUCKET( node_st* i , bucket_st* b )
 {
- i->b_next = b->p_first;
- b->p_first->b_prev = i;
+ i->b_next = LINK( b->p_first );
+ b->p_first->b_prev = LINK( i );
  b->p_first = i;
  }
 
 /*--------------------------------------------------------------------------*/
 
-inline void CS2::GET_FROM_BUCKET( node_st *&i , bucket_st *b )
+template< class FT , class CT >
+inline void CS2T< FT , CT >::GET_FROM_BUCKET( node_st *&i , bucket_st *b )
 {
  i = b->p_first;
- b->p_first = i->b_next;
+ b->p_first = NODE( i->b_next );
  }
 
 /*--------------------------------------------------------------------------*/
 
-inline void CS2::REMOVE_FROM_BUCKET( node_st *i , bucket_st *b )
+template< class FT , class CT >
+inline void CS2T< FT , CT >::REMOVE_FROM_BUCKET( node_st *i , bucket_st *b )
 {
  if( i == b->p_first )
-  b->p_first = i->b_next;
+  b->p_first = NODE( i->b_next );
  else {
-  i->b_prev->b_next = i->b_next;
-  i->b_next->b_prev = i->b_prev;
+  NODE( i->b_prev )->b_next = i->b_next;
+  NODE( i->b_next )->b_prev = i->b_prev;
   }
  }
 
 /*--------------------------------------------------------------------------*/
 
-inline void CS2::STACKQ_PUSH( node_st* i )
+template< class FT , class CT >
+inline void CS2T< FT , CT >::STACKQ_PUSH( node_st* i )
 {
- i->q_next = excq_first;
+ i->q_next = LINK( excq_first );
  excq_first = i;
  }
 
 /*--------------------------------------------------------------------------*/
 
-void CS2::MemAlloc( void )
+template< class FT , class CT >
+void CS2T< FT , CT >::MemAlloc( void )
 {
- //!! arcs = new arc_st[ 2 * mmax + 1 ];
- arcs = new arc_st[ 2 * mmax ];
+ // nodes[ 0 ] is used as a dummy node (e.g. by the bucket lists), and
+ // nodes[ nmax + 1 ] is the sentinel, hence nmax + 2 entries are needed
+ cIndex nn = nmax + 2;
+ cIndex na = 2 * mmax;
+ #if( CS2_INDEX_LINKS )
+  cIndex np = 2 * mmax;  // the inverse arcs follow the direct ones
+ #else
+  cIndex np = mmax;
+ #endif
 
- //!! nodes = new node_st[ nmax + 2 ];
- nodes = new node_st[ nmax + 1 ];
- nodes--;
+ // only BUCKETS_MIN of the linf possible buckets are there at first, see
+ // grow_buckets()
+ linf = Index( nmax * Par.ScaleFactor + 2 );
+ b_size = ( Index( linf ) < BUCKETS_MIN ? Index( linf ) : BUCKETS_MIN );
+
+ // the size of the block - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+ size_t sz = MemArena::Round( nn * sizeof( node_st ) ) +
+             MemArena::Round( na * sizeof( arc_st ) ) +
+             MemArena::Round( np * sizeof( arc_t ) ) +
+             MemArena::Round( nn * sizeof( Index ) ) +
+             MemArena::Round( b_size * sizeof( bucket_st ) );
+ #if( CS2_SOA_ARCS )
+  sz += MemArena::Round( na * sizeof( FT ) ) +
+        MemArena::Round( na * sizeof( CT ) ) +
+        MemArena::Round( na * sizeof( Index ) );
+ #endif
+
+ if( ar_new || ( ar.Size() < sz ) || ( ar.Size() / 2 > sz ) ) {
+  if( ! ar.Reserve( sz , ar_huge != FALSE , ar_node ) ) {
+   nmax = mmax = 0;
+   throw( MCFException( "CS2::MemAlloc: cannot get the working storage" ) );
+   }
 
- linf = Index( nmax * SCALE_DEFAULT + 2 );
- buckets = new bucket_st[ linf ];
- l_bucket = buckets + linf;
+  ar_new = FALSE;
+  ar_touch = TRUE;
+  }
+ else
+  ar.Rewind();
 
- typedef arc_st* ptr_arc_st;
- pos =  new ptr_arc_st[ mmax ]; 
+ // carving the arrays- - - - - - - - - - - - - - - - - - - - - - - - - - - -
+ // the ones the hot loops scan come first
+
+ nodes = (node_st *) ar.Take( nn * sizeof( node_st ) );
+ #if( CS2_SOA_ARCS )
+  a_r_cap = (FT *) ar.Take( na * sizeof( FT ) );
+  a_cost = (CT *) ar.Take( na * sizeof( CT ) );
+  a_head = (Index_Set) ar.Take( na * sizeof( Index ) );
+ #endif
+ arcs = (arc_st *) ar.Take( na * sizeof( arc_st ) );
+ pos = (arc_t *) ar.Take( np * sizeof( arc_t ) );
+ buckets = (bucket_st *) ar.Take( b_size * sizeof( bucket_st ) );
+ ld_first = (Index_Set) ar.Take( nn * sizeof( Index ) );
 
  }  // end( CS2::MemAlloc )
 
 /*--------------------------------------------------------------------------*/
 
-void CS2::MemDeAlloc( void )
+template< class FT , class CT >
+void CS2T< FT , CT >::MemDeAlloc( void )
 {
- delete[] pos;
- delete[] buckets;
- //!! delete[] nodes;
- delete[] ++nodes;
- delete[] arcs;
+ delete[] rf_rcv;
+ rf_rcv = NULL;
+ rf_rsize = 0;
+ delete[] rf_nds;
+ rf_nds = NULL;
+
+ delete[] pu_recs;
+ pu_recs = NULL;
+ pu_rsize = 0;
+ delete[] pu_front;
+ pu_front = NULL;
+
+ delete[] ld_hist;
+ ld_hist = NULL;
+ ld_hsize = 0;
+
+ // the rest is in ar, which is kept for the next MemAlloc()
+
+ if( ! ar.Owns( buckets ) )
+  delete[] buckets;
+ buckets = NULL;
 
  }  // end( CS2::MemDeAlloc )
 
+/*-------------------------------------------------------------------------*/
+/*---------------------- EXPLICIT INSTANTIATIONS --------------------------*/
+/*-------------------------------------------------------------------------*/
+
+template class CS2T< FNumber , CNumber >;
+template class CS2T< int , int >;
+template class CS2T< long long , long long >;
+
 /*-------------------------------------------------------------------------*/
 /*---------------------- End File CS2.C -----------------------------------*/
 /*-------------------------------------------------------------------------*/
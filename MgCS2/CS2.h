@@ -88,6 +88,10 @@
 
 #include "MCFClass.h"
 
+#include "MemArena.h"
+
+#include <limits>
+
 /*--------------------------------------------------------------------------*/
 /*------------------------------- MACROS -----------------------------------*/
 /*--------------------------------------------------------------------------*/
@@ -100,7 +104,9 @@
 
 /*----------------------------- DYNMC_MCF_CS2 ------------------------------*/
 
-#define DYNMC_MCF_CS2 0
+#ifndef DYNMC_MCF_CS2
+ #define DYNMC_MCF_CS2 0
+#endif
 
 /**< Decides if the graph topology (arcs, nodes) can be changed.
    If DYNMC_MCF_CS2 > 0, the methods of the public interface of class that
@@ -110,14 +116,72 @@
    - 0 => the topology of the graph cannot be changed;
 
    - 1 => the methods that change the topology of the graph are
-          implemented. */
+          implemented.
+
+   The macro is only defined here if it is not already defined, so that a
+   build variant can switch the dynamic topology on from the compiler
+   command line (e.g. /D DYNMC_MCF_CS2=1), as the MgCS2 project does. */
+
+/*------------------------------ CS2_SOA_ARCS ------------------------------*/
+
+#ifndef CS2_SOA_ARCS
+ #define CS2_SOA_ARCS 0
+#endif
+
+/**< Decides the memory layout of the arcs. Possible values of this macro
+   are:
+
+   - 0 => each arc is an arc_st holding all its fields, and arcs and nodes
+          are referred to by pointers (array of structures);
+
+   - 1 => the fields scanned by the hot loops of discharge(), relabel(),
+          price_update(), refine() and price_refine(), i.e. the residual
+          capacity, the cost and the head node, are stored in three
+          separate contiguous arrays, while the sister and position of each
+          arc live in the arc_st; arcs and head nodes are referred to by
+          32-bit indices rather than pointers (structure of arrays).
+
+   A scan of the star of a node then only brings into cache the fields it
+   uses. On a 447 x 447 split-node routing grid with one connection per row
+   this roughly halves the solve time; on grids whose solves are dominated
+   by many refine() phases the difference is within the noise. Like
+   DYNMC_MCF_CS2, the macro is only defined here if it is not
+   already defined, so it can be set from the compiler command line. */
+
+/*---------------------------- CS2_INDEX_LINKS -----------------------------*/
+
+#ifndef CS2_INDEX_LINKS
+ #define CS2_INDEX_LINKS 0
+#endif
+
+/**< If CS2_INDEX_LINKS > 0, all the links in the data structures of CS2 are
+   32-bit indices, which roughly halves their memory on 64-bit platforms:
+   besides the arcs and head nodes (see CS2_SOA_ARCS, which is implied),
+   the push queue and bucket links q_next, b_next and b_prev of the nodes
+   are indices into nodes[]. Furthermore, the sister of an arc is not
+   stored in the arc: pos[] is doubled to also hold, for each original arc,
+   the arc_st representing its inverse, and the sister is found there from
+   the position of the arc. This saves one more Index per arc, at the cost
+   of one more indirection in SISTER().
+
+   The MCFClass interface is unaffected. */
+
+#if( CS2_INDEX_LINKS && ! CS2_SOA_ARCS )
+ #undef CS2_SOA_ARCS
+ #define CS2_SOA_ARCS 1
+#endif
 
 /*------------------------- CS2_STATISTICS ---------------------------------*/
 
-#define CS2_STATISTICS 0
+#ifndef CS2_STATISTICS
+ #define CS2_STATISTICS 1
+#endif
 
 /**< If CS2_STATISTICS > 0, then statistic information about the behaviour of
-   the cost-scaling algorithm is computed. */
+   the cost-scaling algorithm is computed, and can be read with
+   GetStatistics(): it is just a few counter increments, so it is on by
+   default. With CS2_STATISTICS == 0 the counters are compiled out, and
+   only the number of phases and the time are available. */
 
 /*@} -----------------------------------------------------------------------*/
 /*--------------------------- NAMESPACE ------------------------------------*/
@@ -134,11 +198,411 @@ namespace MCFClass_di_unipi_it
 /** @defgroup CS2_CLASSES Classes in CS2.h
     @{ */
 
-/** The CS2 class derives from the abstract base class MCFClass, thus sharing
-    its (standard) interface, and implements a push-relabel cost-scaling
-    algorithm for solving (Linear) Min Cost Flow problems */
+/** The CS2Base class derives from the abstract base class MCFClass, and
+    adds to its (standard) interface the methods that all the CS2T solvers
+    below have in common, whatever the types they use for flows and costs,
+    so that any of them can be used through a pointer to CS2Base. */
+
+class CS2Base: public MCFClass {
+
+ public:
+
+/*--------------------------------------------------------------------------*/
+/** Public enum describing the engines that refine() may use to turn a
+    preflow into an epsilon-optimal flow, see SetRefine(). */
+
+  enum CS2Refine { kFIFORefine = 0 ,  ///< one node at a time, FIFO queue
+		   kWaveRefine        ///< all active nodes at once, in waves
+                   };
+
+/*--------------------------------------------------------------------------*/
+/** Public struct holding the parameters of the heuristics of the cost
+    scaling, see SetParams(). The defaults are those of the original CS2
+    code, which were tuned on transportation problems. */
+
+  struct CS2Params {
+   double UpdtFreq;        ///< a global price update is done after
+   Index  UpdtFreqS;       ///< UpdtFreq * n + UpdtFreqS * n_src relabels
+   Index  ScaleFactor;     ///< epsilon is divided by it at each phase, >= 2
+   Index  PriceOutStart;   ///< first phase using price out and in, >= 1
+   double CutOffPower;     ///< the initial cut-off factor is
+   double CutOffCoef;      ///< CutOffCoef * n^CutOffPower
+   double CutOffPower2;    ///< after a successful price in, it is reset
+   double CutOffCoef2;     ///< to CutOffCoef2 * n^CutOffPower2
+   double CutOffGap;       ///< arcs are priced in under this * cut-off
+   double CutOffMin;       ///< the least cut-off factor
+   double CutOffIncrease;  ///< it grows by this after a bad price in
+   char   TimeForPriceIn1; ///< the number of global updates between the
+   char   TimeForPriceIn2; ///< price ins of a phase: the first, second
+   char   TimeForPriceIn3; ///< and any later interval
+
+   CS2Params( void ) : UpdtFreq( 0.4 ) , UpdtFreqS( 30 ) , ScaleFactor( 12 ) ,
+    PriceOutStart( 10 ) , CutOffPower( 0.44 ) , CutOffCoef( 1.5 ) ,
+    CutOffPower2( 0.75 ) , CutOffCoef2( 1 ) , CutOffGap( 0.8 ) ,
+    CutOffMin( 12 ) , CutOffIncrease( 4 ) , TimeForPriceIn1( 2 ) ,
+    TimeForPriceIn2( 4 ) , TimeForPriceIn3( 6 ) {}
+   };
+
+/*--------------------------------------------------------------------------*/
+
+  CS2Base( cIndex nmx = 0 , cIndex mmx = 0 ) : MCFClass( nmx , mmx ) ,
+   ld_net( 0 ) {}
+
+/*--------------------------------------------------------------------------*/
+
+   void LoadBin( const char *FileName );
+
+/**< Reads a MCF instance in the binary format of MCFBinHeader, as written by
+   WriteMCF( , kBinary ), from the named file. The file is memory-mapped and
+   its columns are handed to LoadNet() right where they are, so that
+   nothing is parsed, and the data is only copied once, by LoadNet() into
+   the forward stars of the solver; as in LoadDMX(), the solver is sized
+   to the instance. An exception is thrown if the file cannot be
+   mapped, or if it is not a valid instance for this build (the sizes of
+   Index, FNumber and CNumber must match). Packed files, see SaveBin(),
+   are unpacked to memory first. */
+
+   virtual void SaveBin( ostream &oStrm , cBOOL Pack = FALSE ) = 0;
+
+/**< Writes the current instance in the binary format of MCFBinHeader, as
+   WriteMCF( , kBinary ) does, but gathering the columns in one sequential
+   walk of the forward stars of the solver, in a buffer as large as the
+   file, rather than arc by arc through the virtual accessors; the ostream
+   must have been opened in binary mode. This is meant to be cheap enough
+   for capturing every instance that is solved.
+
+   If Pack is TRUE, the file has Version 2: the columns are the same, but
+   the node columns hold the differences from the previous arc (modulo the
+   range of Index), and each block of the columns is written as its raw
+   and packed size (two Index) followed by the block compressed with a
+   simple LZ77 scheme, or as it is if that would not be smaller. */
+
+/*--------------------------------------------------------------------------*/
+
+   void LoadDMX( istream &DMXs );
+
+/**< As MCFClass::LoadDMX(), which reads the stream in chunks; it is only
+   redefined to record the statistics of GetLoadStatistics(). */
+
+   void LoadDMX( const char *FileName );
+
+/**< As LoadDMX( istream & ), but the named file is memory-mapped and parsed
+   in place, so that the text is never copied; as the mapping is backed by
+   the file, files larger than the memory can be read. An exception is
+   thrown if the file cannot be mapped, or if it is not valid. */
+
+/*--------------------------------------------------------------------------*/
+/** Public struct describing the last load from a file, by LoadDMX() or
+    LoadBin(); the throughput is Bytes / Time. */
+
+  struct CS2LoadStats {
+   double Bytes;      ///< the size of the text or file read
+   double ReadTime;   ///< the time for reading (and checking) it
+   double Time;       ///< the total time, i.e. including LoadNet()
+
+   CS2LoadStats( void ) : Bytes( 0 ) , ReadTime( 0 ) , Time( 0 ) {}
+   };
+
+   const CS2LoadStats &GetLoadStatistics( void ) const
+   {
+    return( LdSt );
+    }
+
+/**< Returns the statistics of the last LoadDMX() or LoadBin(); they are not
+   changed by LoadNet(). The times are always taken, with an OPTtimers. */
+
+/*--------------------------------------------------------------------------*/
+
+   virtual void SetParams( const CS2Params &NewPar ) = 0;
+
+/**< Replaces the parameters of the heuristics, which are the defaults of
+   CS2Params until this is called; they are used from the next call to
+   SolveMCF() on. An exception is thrown if ScaleFactor < 2 or
+   PriceOutStart < 1. */
+
+   const CS2Params &GetParams( void ) const
+   {
+    return( Par );
+    }
+
+/**< Returns the current parameters of the heuristics. */
+
+/*--------------------------------------------------------------------------*/
+/** Public struct holding the statistics of the last call to SolveMCF(), see
+    GetStatistics(). The counters are 0 if CS2_STATISTICS == 0. */
+
+  struct CS2Stats {
+   long NRefine;      ///< number of refines, i.e. of scaling phases
+   long NPush;        ///< number of push operations
+   long NRelabel;     ///< number of relabel operations
+   long NDischarge;   ///< number of discharge operations
+   long NWave;        ///< number of waves, see SetRefine()
+   long NUpdate;      ///< number of global price updates
+   long NScan;        ///< number of nodes scanned by the price updates
+   long NPRefine;     ///< number of price refines
+   long NPrScan;      ///< number of nodes scanned by the price refines
+   long NPrScan1;     ///< number of nodes pushed by their DFS
+   long NPrScan2;     ///< number of longest distance computations
+   double Time;       ///< time of the solve, if timed (see SetMCFTime())
+
+   CS2Stats( void ) : NRefine( 0 ) , NPush( 0 ) , NRelabel( 0 ) ,
+    NDischarge( 0 ) , NWave( 0 ) , NUpdate( 0 ) , NScan( 0 ) ,
+    NPRefine( 0 ) , NPrScan( 0 ) , NPrScan1( 0 ) , NPrScan2( 0 ) ,
+    Time( 0 ) {}
+   };
+
+   virtual CS2Stats GetStatistics( void ) = 0;
+
+/**< Returns the statistics of the last call to SolveMCF(); they are reset
+   by LoadNet(). */
+
+   virtual CNumber GetEpsilon( void ) = 0;
+
+/**< Returns the epsilon of the current solution, in the units of the costs:
+   every residual arc has a reduced cost (see MCFGetRC()) of at least
+   - GetEpsilon(). When MCFGetStatus() == kOK it is about 1 / ( n + 1 ) at
+   most, which makes the flow optimal for integer costs, but the potentials
+   of MCFGetPi() only nearly so. */
+
+/*--------------------------------------------------------------------------*/
+/** Public enum describing the parts of SolveMCF() that are timed in the
+    trace, see SetTrace(). */
+
+  enum CS2TrKind { kTrRefine = 0 ,      ///< refine()
+                   kTrPriceRefine ,     ///< price_refine()
+                   kTrPriceUpdate ,     ///< price_update()
+                   kTrPriceIn ,         ///< price_in()
+                   kTrPriceOut ,        ///< price_out()
+                   kTrComputePrices     ///< compute_prices()
+                   };
+
+/** Public enum describing the formats of WriteTrace(). */
+
+  enum CS2TrFrmt { kTrCSV = 0 ,         ///< one line per record
+                   kTrJSON              ///< an array of objects
+                   };
+
+/** Public struct describing one timed call in the trace, see SetTrace(). */
+
+  struct CS2TrRec {
+   long   Phase;      ///< the scaling phase (refine) it was done in
+   char   Kind;       ///< what was called, a CS2TrKind
+   double Epsilon;    ///< the (scaled) epsilon when it was called
+   double Start;      ///< when it was called, since the start of the solve
+   double Time;       ///< how long it took
+   };
+
+/*--------------------------------------------------------------------------*/
+
+   virtual void SetTrace( cBOOL TraceIt = TRUE ) = 0;
+
+/**< If TraceIt is TRUE, each following SolveMCF() records the time of each of
+   its calls to the methods in CS2TrKind, with the scaling phase and the
+   epsilon they were called with, so that the phases, and the heuristics
+   within them, can be told apart; the price updates and price ins done
+   inside a refine are part of its time as well as having their own
+   records. The timers are those of MCFClass (OPTtimers). The trace is
+   started anew at each SolveMCF(), and is read with GetTrace() and
+   WriteTrace(). By default, or after SetTrace( FALSE ), nothing is
+   recorded, which costs one test per call. */
+
+/*--------------------------------------------------------------------------*/
+
+   virtual const CS2TrRec *GetTrace( Index &Size ) = 0;
+
+/**< Returns the records of the trace of the last SolveMCF(), in the order in
+   which the calls started, and writes their number in Size. The records
+   belong to the object, and are valid until the next SolveMCF(). */
+
+/*--------------------------------------------------------------------------*/
+
+   inline void WriteTrace( ostream &oStrm , int frmt = kTrCSV );
+
+/**< Writes the trace of the last SolveMCF() to an ostream, either in CSV
+   (kTrCSV), with a header line, or in JSON (kTrJSON); the times are in
+   seconds. */
+
+/*--------------------------------------------------------------------------*/
+
+   virtual void SetPriceUpdateThreads( cIndex nt ) = 0;
+
+/**< Sets the number of threads used by the price update heuristic: with
+   nt > 1, the nodes of each bucket level of its reverse search are scanned
+   concurrently. The prices it computes are the same for any nt, although
+   ties between arcs may be broken differently than by the sequential
+   search, so the optimal flow found may change (but not its objective
+   value); for nt > 1, it does not depend on nt nor on the scheduling of
+   the threads. The default is 1, i.e. the sequential search; without
+   OpenMP support (/openmp) nt > 1 is accepted but runs in a single
+   thread. */
+
+/*--------------------------------------------------------------------------*/
+
+   virtual void SetLoadThreads( cIndex nt ) = 0;
+
+/**< Sets the number of threads used by LoadNet() (and so by LoadDMX() and
+   LoadBin()) to build the forward stars, which it does with a two-pass
+   counting sort: with nt > 1, each thread counts, and then writes, a
+   contiguous range of the arcs, and needs a histogram with one entry per
+   node. The stars are the same for any nt. The default is 1; small
+   networks are always loaded by one thread, and without OpenMP support
+   (/openmp) nt > 1 is accepted but runs in a single thread. */
+
+/*--------------------------------------------------------------------------*/
+
+   virtual void SetRefine( CS2Refine rf , cIndex nt = 1 ) = 0;
+
+/**< Selects the engine of the refine phase of the cost scaling. With
+   kFIFORefine (the default), the active nodes are discharged one at a time,
+   in FIFO order. With kWaveRefine, as long as there are enough active
+   nodes, they are discharged in synchronous waves by nt threads: in each
+   wave, all the active nodes push their excess along their admissible arcs
+   at the same time, then all the nodes that still have some excess are
+   relabelled at the same time, with the prices from before the wave; the
+   queue of the active nodes is then rebuilt, and the last few active nodes
+   of each refine are discharged in FIFO order as usual. Both engines give
+   the same optimal objective value; with integer flows, the flow found in
+   waves does not depend on nt nor on the scheduling of the threads.
+   Without OpenMP support (/openmp) the waves run in a single thread. */
+
+/*--------------------------------------------------------------------------*/
+
+   virtual void SetMemory( cBOOL HugePages , int NumaNode = -1 ) = 0;
+
+/**< Selects how the working storage of the solver is obtained. All the
+   arrays whose size depends on the (maximum) size of the network, and the
+   histogram of LoadNet() (those of its other threads excepted, see
+   SetLoadThreads()), are carved from a single block taken from
+   the operating system (see MemArena.h), which is kept as long as the
+   network does not grow, so that loading a network of the same size again
+   does no allocation at all. If HugePages is TRUE, the block is made of
+   large pages if the system allows it, else of ordinary ones; if
+   NumaNode >= 0, its pages are preferably taken from that NUMA node. In
+   any case, no page is written before LoadNet(), so that each is placed by
+   the thread that first touches it: the one calling LoadNet(), or with
+   more than one thread in SetPriceUpdateThreads(), SetRefine() or
+   SetLoadThreads(), all of them, each taking a contiguous slice of the
+   block. The default is ordinary pages on any node; the choice takes
+   effect at the next LoadNet(), which gets a new block. */
+
+/*--------------------------------------------------------------------------*/
+
+   virtual Index MCFGetPaths( cIndex_Set Strt , cIndex ns , Index_Set Path ,
+			      Index_Set Offs , cIndex maxlen ) = 0;
 
-class CS2: public MCFClass {
+/**< Decomposes the current flow into paths, one for each of the ns nodes in
+   Strt[] (node names as in LoadNet()), by walking the residual network
+   directly: the flow on an arc is its capacity minus its residual capacity,
+   i.e. the residual capacity of its sister. Each path carries one unit of
+   flow, so this is meant for integral flows such as those of unit capacity
+   (e.g. routing) networks: from its start node, a path repeatedly follows
+   the first arc still carrying (unused) flow, until it reaches a node with
+   none left. The nodes entered by the i-th path (the start node excluded)
+   are written in Path[ Offs[ i ] ] .. Path[ Offs[ i + 1 ] - 1 ], so Offs[]
+   must have room for ns + 1 entries. The time is linear in the total length
+   of the paths (times the degree of their nodes), which is returned; if it
+   would exceed maxlen, InINF is returned instead, and Path[] and Offs[] are
+   to be ignored. If Path == NULL, maxlen is ignored and the nodes are kept
+   in the solver instead, see MCFGetPathNodes(), so that the caller can size
+   its own copy from the returned length. The flow itself is left unchanged.
+   The scratch space of the walk is kept by the solver and reused by the
+   next calls, so that only a longer walk than all the previous ones does
+   any allocation. */
+
+/*--------------------------------------------------------------------------*/
+
+   virtual cIndex_Set MCFGetPathNodes( void ) = 0;
+
+/**< The nodes of the paths found by the last call to MCFGetPaths() with
+   Path == NULL, in the same order as Path[] would have them; they are
+   valid until the next call to MCFGetPaths(). */
+
+/*--------------------------------------------------------------------------*/
+
+   virtual ~CS2Base() {}
+
+/*--------------------------------------------------------------------------*/
+
+ protected:
+
+  CS2Params Par;            // the parameters of the heuristics
+  CS2LoadStats LdSt;        // the statistics of the last load from a file
+  double ld_net;            // the time of the last LoadNet()
+
+/*--------------------------------------------------------------------------*/
+
+ };  // end( class CS2Base )
+
+/*--------------------------------------------------------------------------*/
+/*------------------- inline methods implementation ------------------------*/
+/*--------------------------------------------------------------------------*/
+
+inline void CS2Base::WriteTrace( ostream &oStrm , int frmt )
+{
+ static const char *const KindName[] = { "refine" , "price_refine" ,
+					 "price_update" , "price_in" ,
+					 "price_out" , "compute_prices" };
+ Index Size;
+ const CS2TrRec *Trace = GetTrace( Size );
+
+ oStrm.precision( 12 );
+
+ if( frmt == kTrJSON ) {
+  oStrm << "[";
+  for( Index i = 0 ; i < Size ; i++ , Trace++ )
+   oStrm << ( i ? ",\n" : "\n" ) << " { \"phase\": " << Trace->Phase
+	 << ", \"kind\": \"" << KindName[ int( Trace->Kind ) ]
+	 << "\", \"epsilon\": " << Trace->Epsilon
+	 << ", \"start\": " << Trace->Start
+	 << ", \"time\": " << Trace->Time << " }";
+  oStrm << "\n]" << endl;
+  }
+ else {
+  oStrm << "phase,kind,epsilon,start,time" << endl;
+  for( Index i = 0 ; i < Size ; i++ , Trace++ )
+   oStrm << Trace->Phase << "," << KindName[ int( Trace->Kind ) ] << ","
+	 << Trace->Epsilon << "," << Trace->Start << "," << Trace->Time
+	 << endl;
+  }
+ }
+
+/*--------------------------------------------------------------------------*/
+
+/** CS2Prices< CT >::PT is the type of the node prices (and reduced costs) of
+    a CS2T with arc costs of type CT. Since costs are internally scaled by a
+    factor of n, and prices may grow to n times the largest scaled cost,
+    integer costs need a 64-bit type for the prices. */
+
+template< class CT >
+struct CS2Prices
+{
+ typedef long long PT;
+ };
+
+template<>
+struct CS2Prices< double >
+{
+ typedef double PT;
+ };
+
+/*--------------------------------------------------------------------------*/
+
+/** The CS2T class derives from CS2Base, thus sharing the (standard)
+    interface of MCFClass, and implements a push-relabel cost-scaling
+    algorithm for solving (Linear) Min Cost Flow problems.
+
+    The residual capacities and excesses are stored as FT, the arc costs as
+    CT and the node prices as CS2Prices< CT >::PT; the interface still
+    works with FNumber and CNumber, which are converted on the way in and
+    out. If FT and CT are integer types, all the comparisons made by the
+    algorithm are exact, as with EPS_FLOW == 0 and EPS_COST == 0 in
+    MCFClass.h: the epsilons are compiled out. CS2 is the instantiation
+    with FNumber and CNumber, while CS2Int32 and CS2Int64 use 32 and 64 bits
+    integers; the integer ones must only be given integer data, and the
+    scaled costs (n times the costs) must fit in CT. */
+
+template< class FT , class CT >
+class CS2T: public CS2Base {
 
 /*--------------------------------------------------------------------------*/
 /*----------------------- PUBLIC PART OF THE CLASS -------------------------*/
@@ -158,7 +622,7 @@ class CS2: public MCFClass {
 /*---------------------------- CONSTRUCTOR ---------------------------------*/
 /*--------------------------------------------------------------------------*/
 
-  CS2( cIndex nmx = 0 , cIndex mmx = 0 );
+  CS2T( cIndex nmx = 0 , cIndex mmx = 0 );
 
 /**< Constructor of the class, as in MCFClass::MCFClass(). */
 
@@ -178,6 +642,58 @@ class CS2: public MCFClass {
    cost is set to 0: this is done for being subsequently capable of
    "opening" them back with OpenArc(). */
 
+/*--------------------------------------------------------------------------*/
+
+   void SetPriceUpdateThreads( cIndex nt );
+
+/**< See CS2Base::SetPriceUpdateThreads(). */
+
+/*--------------------------------------------------------------------------*/
+
+   void SetLoadThreads( cIndex nt );
+
+/**< See CS2Base::SetLoadThreads(). */
+
+/*--------------------------------------------------------------------------*/
+
+   void SetRefine( CS2Refine rf , cIndex nt = 1 );
+
+/**< See CS2Base::SetRefine(). */
+
+/*--------------------------------------------------------------------------*/
+
+   void SetMemory( cBOOL HugePages , int NumaNode = -1 );
+
+/**< See CS2Base::SetMemory(). */
+
+/*--------------------------------------------------------------------------*/
+
+   void SetParams( const CS2Params &NewPar );
+
+/**< See CS2Base::SetParams(). */
+
+/*--------------------------------------------------------------------------*/
+
+   CS2Stats GetStatistics( void );
+
+/**< See CS2Base::GetStatistics(). */
+
+   CNumber GetEpsilon( void );
+
+/**< See CS2Base::GetEpsilon(). */
+
+/*--------------------------------------------------------------------------*/
+
+   void SetTrace( cBOOL TraceIt = TRUE );
+
+/**< See CS2Base::SetTrace(). */
+
+/*--------------------------------------------------------------------------*/
+
+   const CS2TrRec *GetTrace( Index &Size );
+
+/**< See CS2Base::GetTrace(). */
+
 /*--------------------------------------------------------------------------*/
 /*-------------------- METHODS FOR SOLVING THE PROBLEM ---------------------*/
 /*--------------------------------------------------------------------------*/
@@ -191,6 +707,19 @@ class CS2: public MCFClass {
    void MCFGetX( register FRow F , register Index_Set nms = NULL ,
 		 cIndex strt = 0 , Index stp = InINF );
 
+/*--------------------------------------------------------------------------*/
+
+   Index MCFGetPaths( cIndex_Set Strt , cIndex ns , Index_Set Path ,
+		      Index_Set Offs , cIndex maxlen );
+
+/**< See CS2Base::MCFGetPaths(). */
+
+/*--------------------------------------------------------------------------*/
+
+   cIndex_Set MCFGetPathNodes( void );
+
+/**< See CS2Base::MCFGetPathNodes(). */
+
 /*--------------------------------------------------------------------------*/
 
    void MCFGetRC( register CRow CR , register cIndex_Set nms = NULL ,
@@ -207,6 +736,47 @@ class CS2: public MCFClass {
 
    FONumber MCFGetFO( void );
 
+/*--------------------------------------------------------------------------*/
+
+   FNumber MCFGetUnfCut( Index_Set Cut );
+
+/**< If MCFGetStatus() == kUnfeasible, writes in Cut the (InINF-terminated,
+   ordered) names of the nodes of an unfeasible cut and returns its deficit,
+   which is negative: the nodes of the cut have more supply than the total
+   capacity of the arcs leaving it, all of which are saturated, while the
+   arcs entering it carry no flow. The cut is the one on which the solver
+   stopped, i.e., that price_update() or relabel() found unreachable from
+   the sinks in the residual graph, restricted to the nodes reachable from
+   the sources it contains, so that it holds no dead-end nodes which have
+   nothing to do with the unfeasibility. Cut must have room for n + 1
+   entries, as it is also used as the queue of the visits; the cost is
+   O( m ). Otherwise, or if no such cut is found, *Cut = InINF and 0 is
+   returned. */
+
+/*--------------------------------------------------------------------------*/
+
+   MCFStatePtr MCFGetState( void );
+
+/**< Returns a new CS2State (to be deleted by the caller), which holds the flow
+   of each arc, the price of each node, epsilon, the Blncd flag and the
+   status of the current solution; it takes one PT per node and one FT per
+   arc. */
+
+   void MCFPutState( MCFStatePtr S );
+
+/**< Restores the solution saved in S, which must come from MCFGetState() of
+   a CS2T of the same type and with the same number of nodes and arcs
+   (otherwise an exception is thrown), so that SolveMCF() warm-starts from
+   it. If the instance is the one S was taken from, this is the solution
+   itself, with no solve needed; otherwise, the flows are clipped to the
+   current capacities and the deficits are kept, and unless the flow is
+   still balanced the next SolveMCF() starts by refining it. A saved kOK
+   status is only restored if the flow is still balanced and epsilon
+   optimal, otherwise MCFGetStatus() gives kStopped until the next
+   SolveMCF(). The arcs suspended by the last SolveMCF() are made active,
+   as SolveMCF() does anyway. S is not changed, and can be put back more
+   than once. */
+
 /*--------------------------------------------------------------------------*/
 /*-------------- METHODS FOR READING THE DATA OF THE PROBLEM ---------------*/
 /*--------------------------------------------------------------------------*/
@@ -240,6 +810,16 @@ class CS2: public MCFClass {
 
    inline FNumber MCFDfct( cIndex i );
 
+/*--------------------------------------------------------------------------*/
+
+   void SaveBin( ostream &oStrm , cBOOL Pack = FALSE );
+
+/**< See CS2Base::SaveBin(). */
+
+   void WriteMCF( ostream &oStrm , int frmt = 0 );
+
+/**< As MCFClass::WriteMCF(), but kBinary is written by SaveBin(). */
+
 /*--------------------------------------------------------------------------*/
 /*------------- METHODS FOR ADDING / REMOVING / CHANGING DATA --------------*/
 /*--------------------------------------------------------------------------*/
@@ -291,7 +871,7 @@ class CS2: public MCFClass {
 /*------------------------------ DESTRUCTOR --------------------------------*/
 /*--------------------------------------------------------------------------*/
 
-   virtual ~CS2();
+   virtual ~CS2T();
 
 /*--------------------------------------------------------------------------*/
 /*--------------------- PRIVATE PART OF THE CLASS --------------------------*/
@@ -308,13 +888,33 @@ class CS2: public MCFClass {
 /*---------------------------- PRIVATE TYPES -------------------------------*/
 /*--------------------------------------------------------------------------*/
 
+  typedef typename CS2Prices< CT >::PT PT;  // type of the prices
+
+  static const bool IntFlw = std::numeric_limits< FT >::is_integer;
+  static const bool IntCst = std::numeric_limits< CT >::is_integer;
+
+  // if flows (costs) are integer, the comparisons need no epsilon
+
   struct node_st;   // forward declaration of node_st, as arc_st contains one
                     // node_st pointer (the head node)
 
+ #if( CS2_SOA_ARCS )
+  typedef Index arc_t;      // an arc is its position in the arc arrays
+
+  struct arc_st     // the fields of an arc that the hot loops do not scan -
+  {                 // the others are in a_r_cap[], a_cost[] and a_head[]
+   #if( ! CS2_INDEX_LINKS )
+    arc_t   sister;         // opposite arc (else, see SISTER())
+   #endif
+   SIndex   position;       // arc position: i + 1 if the arc_st represents
+                            // the "original" arc i, - i - 1, if it
+                            // it represents the sister of i
+   };
+ #else
   struct arc_st     // structure describing arcs- - - - - - - - - - - - - - -
   {
-   FNumber  r_cap;          // residual capacity
-   CNumber  cost;           // cost of the arc
+   FT       r_cap;          // residual capacity
+   CT       cost;           // cost of the arc
    node_st *head;           // head node
    arc_st  *sister;         // opposite arc
    SIndex   position;       // arc position: i + 1 if the arc_st represents
@@ -322,40 +922,149 @@ class CS2: public MCFClass {
                             // it represents the sister of i
    };
 
+  typedef arc_st *arc_t;    // an arc is a pointer to its arc_st
+ #endif
+
+  #if( CS2_INDEX_LINKS )
+   typedef Index link_t;    // a node is linked by its index in nodes[]
+  #else                     // (InINF standing for NULL), or by a pointer
+   typedef node_st *link_t; // to it
+  #endif
+
   struct node_st    // structure describing nodes - - - - - - - - - - - - - -
   {
-   arc_st  *first;          // first outgoing arc
-   arc_st  *current;        // current outgoing arc
-   arc_st  *suspended;      // first suspended arc
+   arc_t    first;          // first outgoing arc
+   arc_t    current;        // current outgoing arc
+   arc_t    suspended;      // first suspended arc
    #if( DYNMC_MCF_CS2 )
-    arc_st *closed;         // first closed arc
+    arc_t   closed;         // first closed arc
    #endif
-   FNumber  excess;         // excess of the node
-   CNumber  price;          // distance from a sink
-   node_st *q_next;         // next node in push queue
-   node_st *b_next;         // next node in bucket-list
-   node_st *b_prev;         // previous node in bucket-list
+   FT       excess;         // excess of the node
+   PT       price;          // distance from a sink
+   link_t   q_next;         // next node in push queue
+   link_t   b_next;         // next node in bucket-list
+   link_t   b_prev;         // previous node in bucket-list
    SIndex   rank;           // bucket number
    char     inp;            // temporary number of input arcs
    };
 
+  class CS2State : public MCFState {  // the state of MCFGetState() - - - - -
+   public:
+    CS2State( cIndex pn , cIndex pm ) : n( pn ) , m( pm ) ,
+     price( new PT[ pn ] ) , flow( new FT[ pm ] ) {}
+
+    ~CS2State()
+    {
+     delete[] flow;
+     delete[] price;
+     }
+
+    Index n;                // number of nodes
+    Index m;                // number of arcs
+    PT *price;              // the prices of the nodes
+    FT *flow;               // the flows on the arcs, by name
+    PT epsilon;             // the optimality bound
+    BOOL Blncd;             // TRUE if the flow is balanced
+    int status;             // the status of the solution
+
+   private:
+    CS2State( const CS2State & );
+    CS2State &operator=( const CS2State & );
+   };
+
   struct bucket_st  // structure describing buckets - - - - - - - - - - - - -
   {
    node_st *p_first;        // 1st node with positive exces or simply 1st
                             // node in the bucket
    };
 
+  struct pu_rec_st  // a rank decrease found by a thread of price_update()- -
+  {
+   node_st *node;           // the node whose rank decreases
+   arc_t    arc;            // the arc entering it (its new current)
+   SIndex   rank;           // its new rank
+   };
+
+  struct wave_st    // an active node in a wave of refine() - - - - - - - - -
+  {
+   node_st *node;           // the node
+   FT       exc;            // its excess at the start of the wave
+   PT       price;          // its new price, if it is relabelled
+   arc_t    cur;            // its new current arc, if it is relabelled
+   Index    rcv;            // the nodes it pushes to are rf_rcv[ h ] for
+   Index    rcv_stop;       // rcv <= h < rcv_stop
+   char     relab;          // TRUE if it has to be relabelled
+   };
+
 /*--------------------------------------------------------------------------*/
 /*-------------------------- PRIVATE METHODS -------------------------------*/
 /*--------------------------------------------------------------------------*/
 
-   inline void updtarccst( arc_st *arc , cCNumber NCa );
+   inline FT &RCAP( arc_t a );
+
+   inline CT &COST( arc_t a );
+
+   inline node_st *HEAD( arc_t a );
+
+   inline void SET_HEAD( arc_t a , node_st *j );
+
+   inline arc_t &SISTER( arc_t a );
+
+   inline SIndex &POSITION( arc_t a );
+
+   // the fields of arc a, whatever the layout (see CS2_SOA_ARCS)
+
+/*--------------------------------------------------------------------------*/
+
+   inline arc_t ARC( cIndex k );
+
+   inline Index ARC_NUM( const arc_t a );
+
+   // the arc in position k of the arc arrays, and the position of arc a
+
+/*--------------------------------------------------------------------------*/
+
+   inline node_st *NODE( const link_t l );
+
+   inline link_t LINK( node_st *i );
+
+   // the node linked by l, and the link to node i (see CS2_INDEX_LINKS)
+
+/*--------------------------------------------------------------------------*/
+
+   inline FT EPS_FLW( void ) const;
+
+   inline FT EPS_DFCT( void ) const;
+
+   inline PT EPS_CST( void ) const;
+
+   // EpsFlw, EpsDfct and EpsCst, or 0 if flows (costs) are integer
+
+/*--------------------------------------------------------------------------*/
+
+   inline FT FLW_INF( void ) const;
+
+   inline CT CST_INF( void ) const;
+
+   // the stored values of an infinite capacity (F_INF) and of the
+   // infinite cost of a nonexistent arc (C_INF)
+
+/*--------------------------------------------------------------------------*/
+
+   inline CT SCALED_COST( cCNumber c );
+
+   // the cost c scaled by n, as stored in the arcs; if CT is integer,
+   // throws if the scaled cost does not fit
+
+/*--------------------------------------------------------------------------*/
+
+   inline void updtarccst( arc_t arc , cCNumber NCa );
 
    // updates the cost of arc to NCa, handling reoptimization
 
 /*--------------------------------------------------------------------------*/
 
-   inline void updtarccap( arc_st *arc , cFNumber NCa );
+   inline void updtarccap( arc_t arc , cFNumber NCa );
 
    // updates the capacity of arc to NCa, handling reoptimization
 
@@ -363,6 +1072,15 @@ class CS2: public MCFClass {
 
    BOOL price_update( void );
 
+   void scan_bucket_par( cSIndex r , Index &remain , SIndex &top );
+
+   // scans all the nodes of bucket r in price_update() with pu_thrds
+   // threads: the nodes currently in r are scanned concurrently, while the
+   // rank decreases they find are only recorded, and then applied in thread
+   // order, until r stays empty; remain is decreased by the number of
+   // sources scanned, and the scan stops as soon as it gets to 0; top is
+   // raised to the farthest bucket a node is moved to
+
 /*--------------------------------------------------------------------------*/
 
    BOOL relabel( node_st *i );
@@ -379,6 +1097,21 @@ class CS2: public MCFClass {
 
    void refine( void ); 
 
+/*--------------------------------------------------------------------------*/
+
+   void wave( void );
+
+   // discharges all the nodes in the excess queue in one synchronous wave,
+   // with rf_thrds threads (see SetRefine()), and rebuilds the queue
+
+/*--------------------------------------------------------------------------*/
+
+   BOOL global_update( char &pr_in_int );
+
+   // the price update (and price in) refine() periodically does, with
+   // pr_in_int the number of updates since the last price in; returns TRUE
+   // if the problem turns out to be unfeasible
+
 /*--------------------------------------------------------------------------*/
 
    BOOL price_refine( void );
@@ -397,27 +1130,27 @@ class CS2: public MCFClass {
 
 /*--------------------------------------------------------------------------*/
 
-   inline CNumber REDUCED_COST( const node_st *i , const node_st *j ,
-				const arc_st *a );
+   inline PT REDUCED_COST( const node_st *i , const node_st *j ,
+			   const arc_t a );
 
    // computes the reduced cost of arc (i, j) == a
 
 /*--------------------------------------------------------------------------*/
 
-   inline BOOL SUSPENDED( const node_st *i , const arc_st *a );
+   inline BOOL SUSPENDED( const node_st *i , const arc_t a );
 
    // TRUE if the arc a, outgoing from i, is suspended
 
 /*--------------------------------------------------------------------------*/
 
-   inline void EXCHANGE( arc_st* a , arc_st* b );
+   inline void EXCHANGE( arc_t a , arc_t b );
 
    // exchange arc position 
 
 /*--------------------------------------------------------------------------*/
 
-   inline void INCREASE_FLOW( node_st* i , node_st* j , arc_st* a ,
-			      cFNumber df );
+   inline void INCREASE_FLOW( node_st* i , node_st* j , arc_t a ,
+			      const FT df );
 
    // increas arc flow of an amount df
 
@@ -425,6 +1158,51 @@ class CS2: public MCFClass {
 
    void UPDATE_CUT_OFF( void );
 
+/*-------------------------------------------------------------------------*/
+
+   inline void reset_stats( void );
+
+   // reset the statistics read by GetStatistics()
+
+/*-------------------------------------------------------------------------*/
+
+   Index tr_begin( char kind );
+
+   // add a record of the given kind to the trace, starting now, and
+   // return its index
+
+   void pt_grow( cIndex len );
+
+   // make room for twice as many entries in the scratch space of
+   // MCFGetPaths(), keeping the first len of them
+
+/*-------------------------------------------------------------------------*/
+
+   void tr_end( cIndex k );
+
+   // set the time of the record k of the trace, ending now
+
+/*-------------------------------------------------------------------------*/
+
+   class tr_guard {         // times the method it is declared in, if the
+    public:                 // trace is on
+     tr_guard( CS2T *s , char kind ) : cs2( s->tr_t ? s : NULL )
+     {
+      if( cs2 )
+       k = cs2->tr_begin( kind );
+      }
+
+     ~tr_guard()
+     {
+      if( cs2 )
+       cs2->tr_end( k );
+      }
+
+    private:
+     CS2T *cs2;
+     Index k;
+    };
+
 /*-------------------------------------------------------------------------*/
 
    inline void RESET_EXCESS_Q( void );
@@ -453,6 +1231,20 @@ class CS2: public MCFClass {
 
    // empties bucket b
 
+/*-------------------------------------------------------------------------*/
+
+   inline bucket_st *BUCKET( cSIndex r );
+
+   // returns the bucket of rank r < linf, growing buckets[] if it is not
+   // there yet
+
+/*-------------------------------------------------------------------------*/
+
+   void grow_buckets( cSIndex r );
+
+   // enlarges buckets[] so that it contains the bucket of rank r: the size
+   // is (at least) doubled, but never beyond linf
+
 /*-------------------------------------------------------------------------*/
 
    inline BOOL NONEMPTY_BUCKET( bucket_st *b );
@@ -481,6 +1273,10 @@ class CS2: public MCFClass {
 
    void MemAlloc();
 
+   // carves all the arrays sized by nmax and mmax out of ar, getting a new
+   // block first if it is too small (or much too large), or if SetMemory()
+   // has been called since
+
    void MemDeAlloc();
 
 /*--------------------------------------------------------------------------*/
@@ -491,19 +1287,53 @@ class CS2: public MCFClass {
 
   BOOL reopt;               // TRUE if only costs have changed, so the first
                             // part of the algorithm is skipped
-  CNumber dn;               // number of nodes in CNumber
+  PT dn;                    // scale factor of the costs, n + 1 in PT
+
+  MemArena ar;              // the block holding the arrays below, up to
+                            // buckets[] included
+  BOOL ar_huge;             // the options of SetMemory(): large pages,
+  int ar_node;              // and the preferred NUMA node
+  BOOL ar_new;              // TRUE if ar is to be obtained anew
+  BOOL ar_touch;            // TRUE if no page of ar has been written yet
 
   node_st *nodes;           // array of nodes
   node_st *sentinel_node;   // next after last
 
   arc_st *arcs;             // array of arcs
-  arc_st *sentinel_arc;     // next after last
+  #if( CS2_SOA_ARCS )
+   FT *a_r_cap;             // residual capacities of the arcs
+   CT *a_cost;              // costs of the arcs
+   Index_Set a_head;        // head nodes of the arcs
+  #endif
+  arc_t sentinel_arc;       // next after last
        
-  arc_st **pos;             // pos[ i ] = pointer to the arc_st representing
-                            // the original arc i
-
-  bucket_st *buckets;       // array of buckets
-  bucket_st *l_bucket;      // last bucket
+  arc_t *pos;               // pos[ i ] = the arc representing the original
+                            // arc i; if CS2_INDEX_LINKS, pos[ mmax + i ] =
+                            // the arc representing its inverse
+
+  Index_Set ld_first;       // the histogram of LoadNet(), in ar
+
+  Index ld_thrds;           // number of threads of LoadNet()
+  Index_Set ld_hist;        // the histograms of the threads of LoadNet()
+  Index ld_hsize;           // size of ld_hist[]
+
+  bucket_st *buckets;       // array of buckets, allocated lazily: the
+                            // first BUCKETS_MIN are in ar, if it grows
+                            // further it is on the heap
+  Index b_size;             // number of buckets in buckets[], <= linf
+
+  Index pu_thrds;           // number of threads of price_update()
+  node_st **pu_front;       // the nodes of the bucket being scanned
+  pu_rec_st *pu_recs;       // the rank decreases found by the threads
+  Index pu_rsize;           // size of pu_recs[]
+  Index_Set pu_offs;        // the records of thread t are pu_recs[ h ] for
+  Index_Set pu_ends;        // pu_offs[ t ] <= h < pu_ends[ t ]
+
+  CS2Refine rf_mode;        // the engine of refine()
+  Index rf_thrds;           // number of threads of the waves of refine()
+  wave_st *rf_nds;          // the active nodes of the current wave
+  node_st **rf_rcv;         // the nodes pushed to in the current wave
+  Index rf_rsize;           // size of rf_rcv[]
 
   #if( CS2_STATISTICS )
    long n_push;             // current number of push operations
@@ -516,8 +1346,21 @@ class CS2: public MCFClass {
    long n_prscan1;          // current number of stack_push
    long n_prscan2;          // current number of compute longest distances
    long n_prefine;          // current number of price refine
+   long n_wave;             // current number of waves
   #endif
 
+  double st_time;           // time of the last SolveMCF(), if timed
+
+  OPTtimers *tr_t;          // the clock of the trace, NULL if off
+  CS2TrRec *tr_recs;        // the records of the trace
+  Index tr_size;            // number of records in tr_recs[]
+  Index tr_max;             // room in tr_recs[]
+
+  arc_t *pt_used;           // the arcs walked by MCFGetPaths()
+  FT *pt_taken;             // the flow it took from them
+  Index_Set pt_node;        // the nodes it entered, if kept in the solver
+  Index pt_max;             // room in pt_used[], pt_taken[] and pt_node[]
+
   long n_bad_pricein;       // current number of recalculating excess queue
   long n_bad_relabel;       // current number of bad relabel
   long n_rel;               // number of relabels from last price update 
@@ -529,17 +1372,18 @@ class CS2: public MCFClass {
   node_st *excq_first;      // first node in push-queue
   node_st *excq_last;       // last node in push-queue
 
-  SIndex linf;              // number of buckets + 1
+  SIndex linf;              // the "infinite" rank, i.e., the maximum
+                            // number of buckets + 1
 
   CNumber m_c;              // max arc cost
-  CNumber cut_on;           // the bound for returning suspended arcs
-  CNumber cut_off;          // the bound for suspending arcs
-  CNumber epsilon;          // optimality bound
+  PT cut_on;                // the bound for returning suspended arcs
+  PT cut_off;               // the bound for suspending arcs
+  PT epsilon;               // optimality bound
 
   double cut_off_factor;    // multiplier to produce cut_on and cut_off from
                             // n and epsilon
 
-  FNumber total_excess;     // total excess
+  FT total_excess;          // total excess
 
   BOOL flag_price;          // TRUE = signal to start price-in ASAP, maybe
                             // there is infeasibility because of suspended
@@ -553,46 +1397,263 @@ class CS2: public MCFClass {
 
 /*--------------------------------------------------------------------------*/
 
- };  // end( class CS2 )
+ };  // end( class CS2T )
+
+/*--------------------------------------------------------------------------*/
+
+typedef CS2T< FNumber , CNumber > CS2;          ///< the "standard" CS2
+
+typedef CS2T< int , int > CS2Int32;              ///< 32 bits integer data
+
+typedef CS2T< long long , long long > CS2Int64;  ///< 64 bits integer data
 
 /* @} end( group( CS2_CLASSES ) ) */
 /*-------------------------------------------------------------------------*/
 /*-------------------inline methods implementation-------------------------*/
 /*-------------------------------------------------------------------------*/
 
-inline Index CS2::MCFSNde( cIndex i )
+#if( CS2_SOA_ARCS )
+
+template< class FT , class CT >
+inline FT &CS2T< FT , CT >::RCAP( arc_t a )
+{
+ return( a_r_cap[ a ] );
+ }
+
+template< class FT , class CT >
+inline CT &CS2T< FT , CT >::COST( arc_t a )
+{
+ return( a_cost[ a ] );
+ }
+
+template< class FT , class CT >
+inline typename CS2T< FT , CT >::node_st *CS2T< FT , CT >::HEAD( arc_t a )
+{
+ return( nodes + a_head[ a ] );
+ }
+
+template< class FT , class CT >
+inline void CS2T< FT , CT >::SET_HEAD( arc_t a , node_st *j )
+{
+ a_head[ a ] = Index( j - nodes );
+ }
+
+template< class FT , class CT >
+inline typename CS2T< FT , CT >::arc_t &CS2T< FT , CT >::SISTER( arc_t a )
+{
+ #if( CS2_INDEX_LINKS )
+  cSIndex p = arcs[ a ].position;
+  return( pos[ p > 0 ? mmax + p - 1 : - p - 1 ] );
+ #else
+  return( arcs[ a ].sister );
+ #endif
+ }
+
+template< class FT , class CT >
+inline SIndex &CS2T< FT , CT >::POSITION( arc_t a )
+{
+ return( arcs[ a ].position );
+ }
+
+template< class FT , class CT >
+inline typename CS2T< FT , CT >::arc_t CS2T< FT , CT >::ARC( cIndex k )
+{
+ return( k );
+ }
+
+template< class FT , class CT >
+inline Index CS2T< FT , CT >::ARC_NUM( const arc_t a )
+{
+ return( a );
+ }
+
+#if( CS2_INDEX_LINKS )
+
+template< class FT , class CT >
+inline typename CS2T< FT , CT >::node_st *
+ CS2T< FT , CT >::NODE( const link_t l )
+{
+ return( l == InINF ? NULL : nodes + l );
+ }
+
+template< class FT , class CT >
+inline typename CS2T< FT , CT >::link_t CS2T< FT , CT >::LINK( node_st *i )
+{
+ return( i ? Index( i - nodes ) : InINF );
+ }
+
+#else
+
+template< class FT , class CT >
+inline typename CS2T< FT , CT >::node_st *
+ CS2T< FT , CT >::NODE( const link_t l )
+{
+ return( l );
+ }
+
+template< class FT , class CT >
+inline typename CS2T< FT , CT >::link_t CS2T< FT , CT >::LINK( node_st *i )
+{
+ return( i );
+ }
+
+#endif
+
+#else
+
+template< class FT , class CT >
+inline FT &CS2T< FT , CT >::RCAP( arc_t a )
+{
+ return( a->r_cap );
+ }
+
+template< class FT , class CT >
+inline CT &CS2T< FT , CT >::COST( arc_t a )
+{
+ return( a->cost );
+ }
+
+template< class FT , class CT >
+inline typename CS2T< FT , CT >::node_st *CS2T< FT , CT >::HEAD( arc_t a )
+{
+ return( a->head );
+ }
+
+template< class FT , class CT >
+inline void CS2T< FT , CT >::SET_HEAD( arc_t a , node_st *j )
+{
+ a->head = j;
+ }
+
+template< class FT , class CT >
+inline typename CS2T< FT , CT >::arc_t &CS2T< FT , CT >::SISTER( arc_t a )
+{
+ return( a->sister );
+ }
+
+template< class FT , class CT >
+inline SIndex &CS2T< FT , CT >::POSITION( arc_t a )
+{
+ return( a->position );
+ }
+
+template< class FT , class CT >
+inline typename CS2T< FT , CT >::arc_t CS2T< FT , CT >::ARC( cIndex k )
+{
+ return( arcs + k );
+ }
+
+template< class FT , class CT >
+inline Index CS2T< FT , CT >::ARC_NUM( const arc_t a )
+{
+ return( Index( a - arcs ) );
+ }
+
+template< class FT , class CT >
+inline typename CS2T< FT , CT >::node_st *
+ CS2T< FT , CT >::NODE( const link_t l )
+{
+ return( l );
+ }
+
+template< class FT , class CT >
+inline typename CS2T< FT , CT >::link_t CS2T< FT , CT >::LINK( node_st *i )
+{
+ return( i );
+ }
+
+#endif
+
+/*-------------------------------------------------------------------------*/
+
+template< class FT , class CT >
+inline FT CS2T< FT , CT >::EPS_FLW( void ) const
+{
+ return( IntFlw ? FT( 0 ) : FT( EpsFlw ) );
+ }
+
+template< class FT , class CT >
+inline FT CS2T< FT , CT >::EPS_DFCT( void ) const
+{
+ return( IntFlw ? FT( 0 ) : FT( EpsDfct ) );
+ }
+
+template< class FT , class CT >
+inline typename CS2T< FT , CT >::PT CS2T< FT , CT >::EPS_CST( void ) const
+{
+ return( IntCst ? PT( 0 ) : PT( EpsCst ) );
+ }
+
+/*-------------------------------------------------------------------------*/
+
+template< class FT , class CT >
+inline FT CS2T< FT , CT >::FLW_INF( void ) const
+{
+ // an integer "infinite" capacity leaves room for adding flows to it
+
+ return( IntFlw ? std::numeric_limits< FT >::max() / 2 : FT( F_INF ) );
+ }
+
+template< class FT , class CT >
+inline CT CS2T< FT , CT >::CST_INF( void ) const
+{
+ return( IntCst ? std::numeric_limits< CT >::max() : CT( C_INF ) );
+ }
+
+/*-------------------------------------------------------------------------*/
+
+template< class FT , class CT >
+inline CT CS2T< FT , CT >::SCALED_COST( cCNumber c )
+{
+ const CNumber sc = c * CNumber( dn );
+ if( IntCst && ( ( sc >= CNumber( CST_INF() ) ) ||
+		 ( sc <= - CNumber( CST_INF() ) ) ) )
+  throw( MCFException( "CS2T: scaled cost does not fit in the cost type" ) );
+
+ return( CT( sc ) );
+ }
+
+/*-------------------------------------------------------------------------*/
+
+template< class FT , class CT >
+inline Index CS2T< FT , CT >::MCFSNde( cIndex i )
 {
- return( ( (pos[ i ]->sister)->head - nodes ) - USENAME0 );
+ return( ( HEAD( SISTER( pos[ i ] ) ) - nodes ) - USENAME0 );
  }
 
 /*-------------------------------------------------------------------------*/
 
-inline Index CS2::MCFENde( cIndex i )
+template< class FT , class CT >
+inline Index CS2T< FT , CT >::MCFENde( cIndex i )
 {
- return( ( pos[ i ]->head - nodes ) - USENAME0 );
+ return( ( HEAD( pos[ i ] ) - nodes ) - USENAME0 );
  }
 
 /*-------------------------------------------------------------------------*/
 
-inline CNumber CS2::MCFCost( cIndex i )
+template< class FT , class CT >
+inline CNumber CS2T< FT , CT >::MCFCost( cIndex i )
 {
- return( ( pos[ i ]->cost ) / dn );
+ return( CNumber( COST( pos[ i ] ) ) / CNumber( dn ) );
  }
 
 /*-------------------------------------------------------------------------*/
 
-inline FNumber CS2::MCFUCap( cIndex i )
+template< class FT , class CT >
+inline FNumber CS2T< FT , CT >::MCFUCap( cIndex i )
 {
- return( pos[ i ]->r_cap + pos[ i ]->sister->r_cap );
+ const FT u = RCAP( pos[ i ] ) + RCAP( SISTER( pos[ i ] ) );
+ return( IntFlw && ( u >= FLW_INF() ) ? F_INF : FNumber( u ) );
  }
 
 /*-------------------------------------------------------------------------*/
 
-inline BOOL CS2::IsClosedArc( cIndex name )
+template< class FT , class CT >
+inline BOOL CS2T< FT , CT >::IsClosedArc( cIndex name )
 {
  #if( DYNMC_MCF_CS2 )
-  arc_st *arc = pos[ name ];
-  return( arc <= (arc->sister)->head->suspended );
+  arc_t arc = pos[ name ];
+  return( arc < HEAD( SISTER( arc ) )->suspended );
  #else
   return( FALSE );
  #endif
@@ -600,10 +1661,11 @@ inline BOOL CS2::IsClosedArc( cIndex name )
 
 /*--------------------------------------------------------------------------*/
 
-inline BOOL CS2::IsDeletedArc( cIndex name )
+template< class FT , class CT >
+inline BOOL CS2T< FT , CT >::IsDeletedArc( cIndex name )
 {
- return( CS2::IsClosedArc( name ) );  // limited implementation, on par with
-                                      // the one of DelArc()
+ return( CS2T::IsClosedArc( name ) );  // limited implementation, on par
+                                       // with the one of DelArc()
  }
 
 /*-------------------------------------------------------------------------*/
@@ -109,6 +109,7 @@
 
 #include <iomanip>
 #include <sstream>
+#include <string.h>
 
 /*--------------------------------------------------------------------------*/
 /*------------------------- NAMESPACE and USING ----------------------------*/
@@ -307,9 +308,105 @@ class MCFClass {
 
   enum MCFFlFrmt { kDimacs = 0 ,    ///< DIMACS file format for MCF
 		   kMPS ,           ///< MPS file format for LP
-		   kFWMPS           ///< "Fixed Width" MPS format
+		   kFWMPS ,         ///< "Fixed Width" MPS format
+		   kBinary          ///< binary columns, see MCFBinHeader
                    };
 
+/*--------------------------------------------------------------------------*/
+/** Public struct describing the header of the binary file format written by
+    WriteMCF( , kBinary ). The header is followed by five arrays, in the
+    byte order of the machine: the m start nodes (Index), the m end nodes
+    (Index), the m capacities (FNumber), the m costs (CNumber) and the n
+    deficits (FNumber), i.e. exactly the arguments of LoadNet(), with the
+    same meaning; the arcs keep their names, and closed or deleted arcs
+    have cost C_INF. As the header is 32 bytes long, each array is aligned
+    to its type if the file is mapped to an aligned address, so that the
+    arrays can be handed to LoadNet() right where they are. */
+
+  struct MCFBinHeader {
+   char  Magic[ 8 ];   ///< "MCFBIN" followed by two zeroes
+   Index Version;      ///< the version of the format, currently 1
+   Index ISize;        ///< sizeof( Index )
+   Index FSize;        ///< sizeof( FNumber )
+   Index CSize;        ///< sizeof( CNumber )
+   Index NNodes;       ///< n
+   Index NArcs;        ///< m
+   };
+
+/*--------------------------------------------------------------------------*/
+/** Public class reading a DIMACS file line by line, for LoadDMX(). The text
+    is either read from an istream in chunks of BufSize bytes, which is all
+    the memory it needs, or taken from a memory buffer (e.g. a mapped file)
+    as a whole; a line must fit in the buffer. Numbers are converted by
+    hand, so that the locale is never looked at and the stream is only
+    accessed by read(): integers (and decimals that are exactly
+    representable, such as the usual ones) are converted exactly in a
+    single pass, the others are handed to the "C" locale of an istream. */
+
+  class DMXReader {
+   public:
+    DMXReader( istream &DMXs , size_t BufSize = 1 << 20 )
+     : s( &DMXs ) , bsz( BufSize ) , buf( new char[ BufSize ] ) ,
+       p( buf ) , le( buf ) , nl( buf ) , e( buf ) , rd( 0 ) {}
+
+    DMXReader( const char *Data , size_t Size )
+     : s( NULL ) , bsz( 0 ) , buf( NULL ) ,
+       p( Data ) , le( Data ) , nl( Data ) , e( Data + Size ) , rd( Size ) {}
+
+    ~DMXReader() { delete[] buf; }
+
+    inline bool NextLine( void );
+
+    /**< Moves to the next line that is not blank, returning FALSE at the end
+       of the text; an exception is thrown if the stream fails, or if the
+       line is longer than the buffer. */
+
+    char Code( void ) { return( *p++ ); }
+
+    /**< Returns the first character of the line, i.e. its DIMACS code, and
+       moves past it. */
+
+    inline bool Read( Index &x );
+    inline bool Read( double &x );
+
+    /**< Read the next number on the line; they return FALSE if there is none,
+       or if it is malformed (or, for Index, too large). */
+
+    void Skip( void )
+    {
+     while( ( p < le ) && blank( *p ) ) p++;
+     while( ( p < le ) && ! blank( *p ) ) p++;
+     }
+
+    /**< Skips the next word on the line, whatever it is. */
+
+    unsigned long long Bytes( void ) const { return( rd ); }
+
+    /**< The number of bytes read so far (all of them for a memory buffer). */
+
+   private:
+    static bool blank( char c )
+    {
+     return( ( c == ' ' ) || ( c == '\t' ) || ( c == '\r' ) );
+     }
+
+    static bool digit( char c ) { return( ( c >= '0' ) && ( c <= '9' ) ); }
+
+    inline bool fill( void );
+
+    DMXReader( const DMXReader & );
+    DMXReader &operator=( const DMXReader & );
+
+    istream *s;             // the stream, or NULL for a memory buffer
+    size_t bsz;             // the size of buf
+    char *buf;              // the buffer of the stream
+    const char *p;          // the next character of the line
+    const char *le;         // the end of the line
+    const char *nl;         // the start of the next line
+    const char *e;          // the end of the text read so far
+    unsigned long long rd;  // the number of bytes read
+    };
+
 /*--------------------------------------------------------------------------*/
 /** Base class for representing the internal state of the MCF algorithm. */
 
@@ -452,7 +549,14 @@ class MCFClass {
          base class implementation) is more general than the DIMACS standard
 	 format, in that it is allowed to mix node and arc definitions in
 	 any order, while the DIMACS file requires all node information to
-	 appear before all arc information. */
+	 appear before all arc information.
+
+   The base class implementation reads the stream through a DMXReader, i.e.
+   in chunks of fixed size and without looking at the locale, and then
+   passes the instance to LoadNet(); the text is read once, and besides the
+   instance itself only the chunk buffer is needed, however large the file
+   is. Each line holds one descriptor, as in the DIMACS standard; anything
+   following the numbers of a descriptor is ignored. */
 
 /*--------------------------------------------------------------------------*/
 
@@ -969,7 +1073,11 @@ class MCFClass {
    Implementing the proper calls to MCFt->Start() and MCFt->Stop() is due to
    derived classes; these should at least be placed at the beginning and at
    the end, respectively, of SolveMCF() and presumably the Chg***() methods,
-   that is, at least these methods should be "actively timed". */
+   that is, at least these methods should be "actively timed".
+
+   The clock is the one selected by OPT_TIMERS in OPTtypes.h: by default a
+   monotonic wallclock with nanosecond resolution, whose time is returned
+   as user time, so that even the shortest reoptimizations are measured. */
 
 /*- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
@@ -1331,8 +1439,8 @@ class MCFClass {
 /**< Write the current MCF problem to an ostream. This may be useful e.g. for
    debugging purposes.
 
-   The base MCFClass class provides output in two different formats, depending
-   on the value of the parameter frmt:
+   The base MCFClass class provides output in four different formats,
+   depending on the value of the parameter frmt:
 
    - kDimacs  the problem is written in DIMACS standard format, read by most
               MCF codes available;
@@ -1344,6 +1452,10 @@ class MCFClass {
               fields) of the MPS format; this is read by most LP/MIP
 	      solvers, but some codes still require the old format.
 
+    - kBinary the problem is written in the binary format described in
+              MCFBinHeader, which is quickly loaded by e.g. CS2::LoadBin();
+	      the ostream must have been opened in binary mode.
+
    The implementation of WriteMCF() in the base class uses all the above
    methods for reading the data; as such it will work for any derived class
    that properly implements this part of the interface, but it may not be
@@ -1660,6 +1772,15 @@ class MCFClass {
 
  protected:
 
+/*--------------------------------------------------------------------------*/
+/*-------------------------- PROTECTED METHODS -----------------------------*/
+/*--------------------------------------------------------------------------*/
+
+   inline void ReadDMX( DMXReader &DMXr );
+
+/**< Does the work of LoadDMX(), reading the DIMACS text from DMXr; derived
+   classes can use it for reading from other sources than an istream. */
+
 /*--------------------------------------------------------------------------*/
 /*---------------------- PROTECTED DATA STRUCTURES  ------------------------*/
 /*--------------------------------------------------------------------------*/
@@ -1693,36 +1814,35 @@ class MCFClass {
 /*--------------------------------------------------------------------------*/
 
 inline void MCFClass::LoadDMX( istream &DMXs )
+{
+ DMXReader DMXr( DMXs );
+ ReadDMX( DMXr );
+ }
+
+/*--------------------------------------------------------------------------*/
+
+inline void MCFClass::ReadDMX( DMXReader &DMXr )
 {
  // read first non-comment line - - - - - - - - - - - - - - - - - - - - - - -
  // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 
  char c;
- for(;;) {
-  if( ! ( DMXs >> c ) )
+ do
+  if( ! DMXr.NextLine() )
    throw( MCFException( "LoadDMX: error reading the input stream" ) );
-
-  if( c != 'c' )  // if it's not a comment
-   break;
-
-  do              // skip the entire line
-   if( ! DMXs.get( c ) )
-    throw( MCFException( "LoadDMX: error reading the input stream" ) );
-  while( c != '\n' );
-  }
+ while( ( c = DMXr.Code() ) == 'c' );  // skip the comments
 
  if( c != 'p' )
   throw( MCFException( "LoadDMX: format error in the input stream" ) );
 
- char buf[ 3 ];    // free space
- DMXs >> buf;     // skip (in has to be "min")
+ DMXr.Skip();     // skip the problem type (it has to be "min")
 
  Index tn;
- if( ! ( DMXs >> tn ) )
+ if( ! DMXr.Read( tn ) )
   throw( MCFException( "LoadDMX: error reading number of nodes" ) );
 
  Index tm;
- if( ! ( DMXs >> tm ) )
+ if( ! DMXr.Read( tm ) )
   throw( MCFException( "LoadDMX: error reading number of arcs" ) );
 
  // allocate memory - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -1741,88 +1861,97 @@ inline void MCFClass::LoadDMX( istream &DMXs )
  // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 
  Index i = 0;  // arc counter
- for(;;) {
-  if( ! ( DMXs >> c ) )
-   break;
+ try {
+  while( DMXr.NextLine() ) {
+   double num;
+   switch( DMXr.Code() ) {
+    case( 'c' ):  // comment line- - - - - - - - - - - - - - - - - - - - - -
+     break;
 
-  switch( c ) {
-   case( 'c' ):  // comment line- - - - - - - - - - - - - - - - - - - - - - -
-    do
-     if( ! DMXs.get( c ) )
-      throw( MCFException( "LoadDMX: error reading the input stream" ) );
-    while( c != '\n' );
-    break;
+    case( 'n' ):  // description of a node - - - - - - - - - - - - - - - - -
+     Index j;
+     if( ! DMXr.Read( j ) )
+      throw( MCFException( "LoadDMX: error reading node name" ) );
 
-   case( 'n' ):  // description of a node - - - - - - - - - - - - - - - - - -
-    Index j;
-    if( ! ( DMXs >> j ) )
-     throw( MCFException( "LoadDMX: error reading node name" ) );
+     if( ( j < 1 ) || ( j > tn ) )
+      throw( MCFException( "LoadDMX: invalid node name" ) );
 
-    if( ( j < 1 ) || ( j > tn ) )
-     throw( MCFException( "LoadDMX: invalid node name" ) );
+     if( ! DMXr.Read( num ) )
+      throw( MCFException( "LoadDMX: error reading deficit" ) );
 
-    FNumber Dfctj;
-    if( ! ( DMXs >> Dfctj ) )
-     throw( MCFException( "LoadDMX: error reading deficit" ) );
+     tDfct[ j - 1 ] -= FNumber( num );
+     break;
 
-    tDfct[ j - 1 ] -= Dfctj;
-    break;
+    case( 'a' ):  // description of an arc - - - - - - - - - - - - - - - - -
+     if( i == tm )
+      throw( MCFException( "LoadDMX: too many arc descriptors" ) );
 
-   case( 'a' ):  // description of an arc - - - - - - - - - - - - - - - - - -
-    if( i == tm )
-     throw( MCFException( "LoadDMX: too many arc descriptors" ) );
+     if( ! DMXr.Read( tStartn[ i ] ) )
+      throw( MCFException( "LoadDMX: error reading start node" ) );
 
-    if( ! ( DMXs >> tStartn[ i ] ) )
-     throw( MCFException( "LoadDMX: error reading start node" ) );
+     if( ( tStartn[ i ] < 1 ) || ( tStartn[ i ] > tn ) )
+      throw( MCFException( "LoadDMX: invalid start node" ) );
 
-    if( ( tStartn[ i ] < 1 ) || ( tStartn[ i ] > tn ) )
-     throw( MCFException( "LoadDMX: invalid start node" ) );
+     if( ! DMXr.Read( tEndn[ i ] ) )
+      throw( MCFException( "LoadDMX: error reading end node" ) );
 
-    if( ! ( DMXs >> tEndn[ i ] ) )
-     throw( MCFException( "LoadDMX: error reading end node" ) );
+     if( ( tEndn[ i ] < 1 ) || ( tEndn[ i ] > tn ) )
+      throw( MCFException( "LoadDMX: invalid end node" ) );
 
-    if( ( tEndn[ i ] < 1 ) || ( tEndn[ i ] > tn ) )
-     throw( MCFException( "LoadDMX: invalid end node" ) );
+     if( tStartn[ i ] == tEndn[ i ] )
+      throw( MCFException( "LoadDMX: self-loops not permitted" ) );
 
-    if( tStartn[ i ] == tEndn[ i ] )
-     throw( MCFException( "LoadDMX: self-loops not permitted" ) );
+     if( ! DMXr.Read( num ) )
+      throw( MCFException( "LoadDMX: error reading lower bound" ) );
 
-    FNumber LB;
-    if( ! ( DMXs >> LB ) )
-     throw( MCFException( "LoadDMX: error reading lower bound" ) );
+     FNumber LB;
+     LB = FNumber( num );
 
-    if( ! ( DMXs >> tU[ i ] ) )
-     throw( MCFException( "LoadDMX: error reading upper bound" ) );
+     if( ! DMXr.Read( num ) )
+      throw( MCFException( "LoadDMX: error reading upper bound" ) );
 
-    if( ! ( DMXs >> tC[ i ] ) )
-     throw( MCFException( "LoadDMX: error reading arc cost" ) );
+     tU[ i ] = FNumber( num );
 
-    if( tU[ i ] < LB )
-     throw( MCFException( "LoadDMX: lower bound > upper bound" ) );
+     if( ! DMXr.Read( num ) )
+      throw( MCFException( "LoadDMX: error reading arc cost" ) );
 
-    tU[ i ] -= LB;
-    tDfct[ tStartn[ i ] - 1 ] += LB;
-    tDfct[ tEndn[ i ] - 1 ] -= LB;
-    #if( USENAME0 )
-     tStartn[ i ]--;  // in the DIMACS format, node names start from 1
-     tEndn[ i ]--;
-    #endif
-    i++;
-    break; 
+     tC[ i ] = CNumber( num );
 
-   default:  // invalid code- - - - - - - - - - - - - - - - - - - - - - - - -
-    throw( MCFException( "LoadDMX: invalid code" ) );
+     if( tU[ i ] < LB )
+      throw( MCFException( "LoadDMX: lower bound > upper bound" ) );
+
+     tU[ i ] -= LB;
+     tDfct[ tStartn[ i ] - 1 ] += LB;
+     tDfct[ tEndn[ i ] - 1 ] -= LB;
+     #if( USENAME0 )
+      tStartn[ i ]--;  // in the DIMACS format, node names start from 1
+      tEndn[ i ]--;
+     #endif
+     i++;
+     break; 
 
-   }  // end( switch( c ) )
-  }  // end( for( ever ) )
+    default:  // invalid code- - - - - - - - - - - - - - - - - - - - - - - -
+     throw( MCFException( "LoadDMX: invalid code" ) );
 
- if( i < tm )
-  throw( MCFException( "LoadDMX: too few arc descriptors" ) );
+    }  // end( switch( code ) )
+   }  // end( while( lines ) )
 
- // call LoadNet- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
- // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+  if( i < tm )
+   throw( MCFException( "LoadDMX: too few arc descriptors" ) );
 
- LoadNet( tn , tm , tn , tm , tU , tC , tDfct , tStartn , tEndn );
+  // call LoadNet- - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+  // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+  LoadNet( tn , tm , tn , tm , tU , tC , tDfct , tStartn , tEndn );
+  }
+ catch( ... ) {
+  delete[] tC;
+  delete[] tEndn;
+  delete[] tStartn;
+  delete[] tDfct;
+  delete[] tU;
+  throw;
+  }
 
  // delete the original data structures - - - - - - - - - - - - - - - - - - -
  // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -1833,7 +1962,166 @@ inline void MCFClass::LoadDMX( istream &DMXs )
  delete[] tDfct;
  delete[] tU;
 
- }  // end( MCFClass::LoadDMX )
+ }  // end( MCFClass::ReadDMX )
+
+/*--------------------------------------------------------------------------*/
+
+inline bool MCFClass::DMXReader::fill( void )
+{
+ // move the partial line to the front of the buffer, and read after it
+
+ const size_t k = size_t( e - p );
+ if( k == bsz )
+  throw( MCFException( "LoadDMX: line too long" ) );
+
+ memmove( buf , p , k );
+ s->read( buf + k , std::streamsize( bsz - k ) );
+ if( s->bad() )
+  throw( MCFException( "LoadDMX: error reading the input stream" ) );
+
+ const size_t g = size_t( s->gcount() );
+ p = buf;
+ e = buf + k + g;
+ rd += g;
+ return( g > 0 );
+
+ }  // end( MCFClass::DMXReader::fill )
+
+/*--------------------------------------------------------------------------*/
+
+inline bool MCFClass::DMXReader::NextLine( void )
+{
+ for(;;) {
+  p = nl;
+  const char *q;
+  while( ! ( q = (const char *) memchr( p , '\n' , size_t( e - p ) ) ) )
+   if( ( ! s ) || ( ! fill() ) )
+    break;
+
+  if( ! q ) {      // the last line, with no newline
+   if( p == e )
+    return( false );
+
+   q = e;
+   }
+
+  le = q;
+  nl = ( q < e ? q + 1 : q );
+
+  while( ( p < le ) && blank( *p ) )
+   p++;
+
+  if( p < le )
+   return( true );
+  }
+ }  // end( MCFClass::DMXReader::NextLine )
+
+/*--------------------------------------------------------------------------*/
+
+inline bool MCFClass::DMXReader::Read( Index &x )
+{
+ while( ( p < le ) && blank( *p ) )
+  p++;
+
+ if( ( p == le ) || ! digit( *p ) )
+  return( false );
+
+ unsigned long long v = 0;
+ do {
+  v = v * 10 + ( *(p++) - '0' );
+  if( Index( v ) != v )
+   return( false );
+  } while( ( p < le ) && digit( *p ) );
+
+ if( ( p < le ) && ! blank( *p ) )
+  return( false );
+
+ x = Index( v );
+ return( true );
+
+ }  // end( MCFClass::DMXReader::Read( Index ) )
+
+/*--------------------------------------------------------------------------*/
+
+inline bool MCFClass::DMXReader::Read( double &x )
+{
+ static const double P10[] = { 1e0 , 1e1 , 1e2 , 1e3 , 1e4 , 1e5 , 1e6 ,
+			       1e7 , 1e8 , 1e9 , 1e10 , 1e11 , 1e12 , 1e13 ,
+			       1e14 , 1e15 , 1e16 , 1e17 , 1e18 , 1e19 ,
+			       1e20 , 1e21 , 1e22 };
+
+ while( ( p < le ) && blank( *p ) )
+  p++;
+
+ const char *t = p;  // the start of the number
+ bool neg = false;
+ if( ( p < le ) && ( ( *p == '-' ) || ( *p == '+' ) ) )
+  neg = ( *(p++) == '-' );
+
+ // the digits go in the mantissa mnt, as long as it is exact in a double;
+ // the dot and the exponent only move the decimal exponent ex
+
+ unsigned long long mnt = 0;
+ long ex = 0;
+ bool any = false;    // any digit seen
+ bool exact = true;   // mnt * 10^ex is the number
+ for( ; ( p < le ) && digit( *p ) ; p++ , any = true )
+  if( mnt < ( 1ULL << 49 ) )
+   mnt = mnt * 10 + ( *p - '0' );
+  else {
+   ex++;
+   exact &= ( *p == '0' );
+   }
+
+ if( ( p < le ) && ( *p == '.' ) ) {
+  for( p++ ; ( p < le ) && digit( *p ) ; p++ , any = true )
+   if( mnt < ( 1ULL << 49 ) ) {
+    mnt = mnt * 10 + ( *p - '0' );
+    ex--;
+    }
+   else
+    exact &= ( *p == '0' );
+  }
+
+ if( ! any )
+  return( false );
+
+ if( ( p < le ) && ( ( *p == 'e' ) || ( *p == 'E' ) ) ) {
+  p++;
+  bool eneg = false;
+  if( ( p < le ) && ( ( *p == '-' ) || ( *p == '+' ) ) )
+   eneg = ( *(p++) == '-' );
+
+  if( ( p == le ) || ! digit( *p ) )
+   return( false );
+
+  long ev = 0;
+  for( ; ( p < le ) && digit( *p ) ; p++ )
+   if( ev < 100000 )
+    ev = ev * 10 + ( *p - '0' );
+
+  ex += ( eneg ? - ev : ev );
+  }
+
+ if( ( p < le ) && ! blank( *p ) )
+  return( false );
+
+ if( exact && ( ex >= -22 ) && ( ex <= 22 ) ) {
+  // mnt < 2^53 and 10^|ex| are exact, so the result is correctly rounded
+  x = ( ex < 0 ? double( mnt ) / P10[ - ex ] : double( mnt ) * P10[ ex ] );
+  if( neg )
+   x = - x;
+  }
+ else {        // rare: let the "C" locale of a stream do it
+  istringstream is( string( t , p ) );
+  is.imbue( std::locale::classic() );
+  if( ! ( is >> x ) )
+   return( false );
+  }
+
+ return( true );
+
+ }  // end( MCFClass::DMXReader::Read( double ) )
 
 /*--------------------------------------------------------------------------*/
 
@@ -2138,6 +2426,72 @@ inline void MCFClass::WriteMCF( ostream &oStrm , int frmt )
    oStrm << "ENDATA" << endl;
    break;
 
+  case( kBinary ):  // binary columns- - - - - - - - - - - - - - - - - - - - -
+                    //- - - - - - - - - - - - - - - - - - - - - - - - - - - -
+   {
+    // write the header- - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+    MCFBinHeader h;
+    for( Index k = 0 ; k < 8 ; k++ )
+     h.Magic[ k ] = "MCFBIN\0"[ k ];
+
+    h.Version = 1;
+    h.ISize = sizeof( Index );
+    h.FSize = sizeof( FNumber );
+    h.CSize = sizeof( CNumber );
+    h.NNodes = MCFn();
+    h.NArcs = MCFm();
+    oStrm.write( (const char *) &h , sizeof( h ) );
+
+    // write the columns, a chunk at a time- - - - - - - - - - - - - - - - -
+
+    const Index chnk = 8192;
+    Index_Set tI = new Index[ chnk ];
+    FRow tF = new FNumber[ chnk ];
+    CRow tC = new CNumber[ chnk ];
+
+    for( Index i = 0 ; i < h.NArcs ; i += chnk ) {
+     cIndex stp = ( i + chnk < h.NArcs ? i + chnk : h.NArcs );
+     for( Index j = i ; j < stp ; j++ )
+      tI[ j - i ] = MCFSNde( j );
+     oStrm.write( (const char *) tI , ( stp - i ) * sizeof( Index ) );
+     }
+
+    for( Index i = 0 ; i < h.NArcs ; i += chnk ) {
+     cIndex stp = ( i + chnk < h.NArcs ? i + chnk : h.NArcs );
+     for( Index j = i ; j < stp ; j++ )
+      tI[ j - i ] = MCFENde( j );
+     oStrm.write( (const char *) tI , ( stp - i ) * sizeof( Index ) );
+     }
+
+    for( Index i = 0 ; i < h.NArcs ; i += chnk ) {
+     cIndex stp = ( i + chnk < h.NArcs ? i + chnk : h.NArcs );
+     for( Index j = i ; j < stp ; j++ )
+      tF[ j - i ] = MCFUCap( j );
+     oStrm.write( (const char *) tF , ( stp - i ) * sizeof( FNumber ) );
+     }
+
+    for( Index i = 0 ; i < h.NArcs ; i += chnk ) {
+     cIndex stp = ( i + chnk < h.NArcs ? i + chnk : h.NArcs );
+     for( Index j = i ; j < stp ; j++ )
+      tC[ j - i ] = ( IsClosedArc( j ) || IsDeletedArc( j ) ? C_INF :
+		      MCFCost( j ) );
+     oStrm.write( (const char *) tC , ( stp - i ) * sizeof( CNumber ) );
+     }
+
+    for( Index i = 0 ; i < h.NNodes ; i += chnk ) {
+     cIndex stp = ( i + chnk < h.NNodes ? i + chnk : h.NNodes );
+     for( Index j = i ; j < stp ; j++ )
+      tF[ j - i ] = MCFDfct( j );
+     oStrm.write( (const char *) tF , ( stp - i ) * sizeof( FNumber ) );
+     }
+
+    delete[] tC;
+    delete[] tF;
+    delete[] tI;
+    }
+   break;
+
   default:          // unknown format - - - - - - - - - - - - - - - - - - - -
                     //- - - - - - - - - - - - - - - - - - - - - - - - - - - -
    oStrm << "Error: unknown format " << frmt << endl;
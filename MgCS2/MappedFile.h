@@ -0,0 +1,34 @@
+// MappedFile.h
+
+#pragma once
+
+#include <cstddef>
+
+// A read-only memory mapping of a whole file, which stays valid until the
+// MappedFile is closed or destroyed. Kept apart from the solver headers, as
+// <windows.h> clashes with the types of OPTtypes.h.
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	// Maps the named file, closing any previous mapping first; returns
+	// false if the file cannot be opened or mapped (e.g. if it is empty).
+	bool Open(const char *fileName);
+	void Close();
+
+	const void *Data() const { return data; }
+	size_t Size() const { return size; }
+
+private:
+	MappedFile(const MappedFile &);
+	MappedFile &operator=(const MappedFile &);
+
+	const void *data;
+	size_t size;
+#ifdef _WIN32
+	void *file;
+	void *mapping;
+#endif
+};
@@ -0,0 +1,150 @@
+// MemArena.cpp
+
+#include "stdafx.h"
+
+#include "MemArena.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#ifndef MEM_LARGE_PAGES
+#define MEM_LARGE_PAGES 0x20000000
+#endif
+#else
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+MemArena::MemArena()
+	: data(0), size(0), used(0), huge(false)
+{
+}
+
+MemArena::~MemArena()
+{
+	Release();
+}
+
+void *MemArena::Take(size_t bytes, size_t align)
+{
+	size_t start = Round(used, align);
+	if (start > size || bytes > size - start)
+		return 0;
+	used = start + bytes;
+	return data + start;
+}
+
+#ifdef _WIN32
+
+// VirtualAllocExNuma() and GetLargePageMinimum() are looked up at run time,
+// as they are missing from older systems and SDKs.
+typedef LPVOID (WINAPI *VirtualAllocExNumaFn)(HANDLE, LPVOID, SIZE_T, DWORD, DWORD, DWORD);
+typedef SIZE_T (WINAPI *GetLargePageMinimumFn)(void);
+
+static void *allocate(size_t size, DWORD flags, int numaNode)
+{
+	if (numaNode >= 0)
+	{
+		VirtualAllocExNumaFn allocNuma = (VirtualAllocExNumaFn)GetProcAddress(GetModuleHandleA("kernel32.dll"), "VirtualAllocExNuma");
+		if (allocNuma)
+			return allocNuma(GetCurrentProcess(), 0, size, flags, PAGE_READWRITE, DWORD(numaNode));
+	}
+	return VirtualAlloc(0, size, flags, PAGE_READWRITE);
+}
+
+bool MemArena::Reserve(size_t bytes, bool hugePages, int numaNode)
+{
+	Release();
+	if (bytes == 0)
+		bytes = 1;
+	if (hugePages)
+	{
+		GetLargePageMinimumFn largeMin = (GetLargePageMinimumFn)GetProcAddress(GetModuleHandleA("kernel32.dll"), "GetLargePageMinimum");
+		SIZE_T page = largeMin ? largeMin() : 0;
+		if (page)
+		{
+			size_t rounded = Round(bytes, page);
+			data = (char *)allocate(rounded, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, numaNode);
+			if (data)
+			{
+				size = rounded;
+				huge = true;
+				return true;
+			}
+		}
+	}
+	data = (char *)allocate(bytes, MEM_RESERVE | MEM_COMMIT, numaNode);
+	if (!data)
+		return false;
+	size = bytes;
+	return true;
+}
+
+void MemArena::Release()
+{
+	if (data)
+		VirtualFree(data, 0, MEM_RELEASE);
+	data = 0;
+	size = used = 0;
+	huge = false;
+}
+
+#else
+
+static const size_t HUGE_PAGE = size_t(2) << 20;
+
+bool MemArena::Reserve(size_t bytes, bool hugePages, int numaNode)
+{
+	Release();
+	if (bytes == 0)
+		bytes = 1;
+	void *p = MAP_FAILED;
+	size_t rounded = bytes;
+#ifdef MAP_HUGETLB
+	if (hugePages)
+	{
+		rounded = Round(bytes, HUGE_PAGE);
+		p = mmap(0, rounded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		huge = p != MAP_FAILED;
+	}
+#endif
+	if (p == MAP_FAILED)
+	{
+		rounded = bytes;
+		p = mmap(0, rounded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (p == MAP_FAILED)
+			return false;
+#ifdef MADV_HUGEPAGE
+		if (hugePages)
+			madvise(p, rounded, MADV_HUGEPAGE);
+#endif
+	}
+	data = (char *)p;
+	size = rounded;
+#ifdef SYS_mbind
+	// MPOL_PREFERRED, through the system call as libnuma may be missing; as
+	// no page is touched yet, all of them follow the policy
+	const int preferred = 1;
+	const int maskBits = 1024;
+	unsigned long mask[maskBits / (8 * sizeof(unsigned long))] = { 0 };
+	if (numaNode >= 0 && numaNode < maskBits)
+	{
+		mask[numaNode / (8 * sizeof(unsigned long))] = 1UL << (numaNode % (8 * sizeof(unsigned long)));
+		syscall(SYS_mbind, data, size, preferred, mask, (unsigned long)maskBits + 1, 0UL);
+	}
+#endif
+	return true;
+}
+
+void MemArena::Release()
+{
+	if (data)
+		munmap(data, size);
+	data = 0;
+	size = used = 0;
+	huge = false;
+}
+
+#endif
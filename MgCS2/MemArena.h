@@ -0,0 +1,56 @@
+// MemArena.h
+
+#pragma once
+
+#include <cstddef>
+
+// One block of memory, obtained straight from the operating system, out of
+// which a solver carves all its arrays with Take(). The pages are zero and
+// untouched until first written, so they are placed by the thread that
+// writes them first; they can also be asked to be large ("huge") pages, or
+// to come from a given NUMA node. Kept apart from the solver headers, as
+// <windows.h> clashes with the types of OPTtypes.h.
+class MemArena
+{
+public:
+	MemArena();
+	~MemArena();
+
+	// Obtains a block of at least size bytes, releasing any previous one;
+	// returns false if it cannot be had. With hugePages, large pages are
+	// tried first (on Windows they need the "Lock pages in memory"
+	// privilege, on Linux reserved huge pages, else transparent huge pages
+	// are asked for), falling back to ordinary ones; with numaNode >= 0,
+	// the pages are preferably taken from that node.
+	bool Reserve(size_t size, bool hugePages, int numaNode);
+	void Release();
+
+	// Carves the next bytes bytes, aligned to align (a power of 2 not larger
+	// than a page), from the block; returns 0 if they do not fit.
+	void *Take(size_t bytes, size_t align = 64);
+	// Makes the whole block available to Take() again.
+	void Rewind() { used = 0; }
+
+	bool Owns(const void *p) const { return p >= data && p < data + size; }
+	char *Data() const { return data; }
+	size_t Size() const { return size; }
+	size_t Used() const { return used; }
+	// True if the block is made of large pages, rather than just asked to.
+	bool HugePages() const { return huge; }
+
+	// Rounds bytes up as Take() does, so that the size of a block can be
+	// computed as the sum of the rounded sizes of what will be carved.
+	static size_t Round(size_t bytes, size_t align = 64)
+	{
+		return (bytes + align - 1) & ~(align - 1);
+	}
+
+private:
+	MemArena(const MemArena &);
+	MemArena &operator=(const MemArena &);
+
+	char *data;
+	size_t size;
+	size_t used;
+	bool huge;
+};
@@ -10,31 +10,405 @@ inline T ABS( const T x )
  return( x >= T( 0 ) ? x : -x );
  }
 
+MgCS2::MgMCFSolver::MgMCFSolver()
+	: flowBuffer(0), arcBuffer(0), bufferSize(0), priceUpdateThreads(1), loadThreads(1)
+{
+	mcf = newSolver(MgMCFNumbers::Double, 0, 0);
+}
+
+MgCS2::MgMCFSolver::MgMCFSolver(MgMCFNumbers numbers)
+	: flowBuffer(0), arcBuffer(0), bufferSize(0), priceUpdateThreads(1), loadThreads(1)
+{
+	mcf = newSolver(numbers, 0, 0);
+}
+
 MgCS2::MgMCFSolver::MgMCFSolver(unsigned int pn, unsigned int pm, array<double>^ pUA, array<double>^ pCA, array<double>^ pDfctA, array<unsigned int>^ pSnA, array<unsigned int>^ pEnA)
+	: flowBuffer(0), arcBuffer(0), bufferSize(0), priceUpdateThreads(1), loadThreads(1)
+{
+	mcf = newSolver(MgMCFNumbers::Double, pn, pm);
+	loadNet(pn, pm, pUA, pCA, pDfctA, pSnA, pEnA);
+}
+
+MgCS2::MgMCFSolver::~MgMCFSolver()
+{
+	this->!MgMCFSolver();
+}
+
+MgCS2::MgMCFSolver::!MgMCFSolver()
+{
+	delete mcf;
+	mcf = 0;
+	delete[] flowBuffer;
+	delete[] arcBuffer;
+	flowBuffer = 0;
+	arcBuffer = 0;
+	bufferSize = 0;
+}
+
+CS2Base *MgCS2::MgMCFSolver::solver()
+{
+	if (!mcf)
+		throw gcnew ObjectDisposedException("MgMCFSolver");
+	return mcf;
+}
+
+CS2Base *MgCS2::MgMCFSolver::newSolver(MgMCFNumbers numbers, unsigned int nmx, unsigned int mmx)
+{
+	CS2Base *s;
+	switch (numbers)
+	{
+	case MgMCFNumbers::Double:
+		s = new CS2(nmx, mmx);
+		break;
+	case MgMCFNumbers::Int32:
+		s = new CS2Int32(nmx, mmx);
+		break;
+	case MgMCFNumbers::Int64:
+		s = new CS2Int64(nmx, mmx);
+		break;
+	default:
+		throw gcnew ArgumentOutOfRangeException("numbers");
+	}
+	// the time of each solve is part of its statistics
+	s->SetMCFTime();
+	return s;
+}
+
+void MgCS2::MgMCFSolver::Reload(unsigned int pn, unsigned int pm, array<double>^ pUA, array<double>^ pCA, array<double>^ pDfctA, array<unsigned int>^ pSnA, array<unsigned int>^ pEnA)
+{
+	solver();
+	loadNet(pn, pm, pUA, pCA, pDfctA, pSnA, pEnA);
+}
+
+void MgCS2::MgMCFSolver::Reload(MgRoutingNetwork^ network)
+{
+	solver();
+	if (network == nullptr)
+		throw gcnew ArgumentNullException("network");
+	const RoutingNetwork &net = network->Native();
+	initMgMCFSolver(net.VertexCount(), net.ArcCount(), net.Capacities(), net.Costs(), net.Deficits(), net.StartNodes(), net.EndNodes());
+	for (Index k=0; k < net.ClosedArcCount(); k++)
+		mcf->CloseArc(net.ClosedArcs()[k]);
+}
+
+// Both closed arc lists are sorted, so a single merge finds the arcs to
+// reopen (only closed in previous) and to close (only closed in next).
+void MgCS2::MgMCFSolver::Update(MgRoutingNetwork^ previous, MgRoutingNetwork^ next)
+{
+	MCFClass *s = solver();
+	if (previous == nullptr)
+		throw gcnew ArgumentNullException("previous");
+	if (next == nullptr)
+		throw gcnew ArgumentNullException("next");
+	if (!previous->SameTopology(next))
+		throw gcnew ArgumentException("the routing networks must have the same topology");
+	const RoutingNetwork &prev = previous->Native();
+	const RoutingNetwork &net = next->Native();
+	if (s->MCFm() != net.ArcCount())
+		throw gcnew InvalidOperationException("the previous routing network is not loaded");
+
+	const Index *p = prev.ClosedArcs();
+	const Index *pEnd = p + prev.ClosedArcCount();
+	const Index *q = net.ClosedArcs();
+	const Index *qEnd = q + net.ClosedArcCount();
+	while (p != pEnd || q != qEnd)
+	{
+		if (q == qEnd || (p != pEnd && *p < *q))
+			s->OpenArc(*(p++));
+		else if (p == pEnd || *q < *p)
+			s->CloseArc(*(q++));
+		else
+		{
+			p++;
+			q++;
+		}
+	}
+}
+
+unsigned int MgCS2::MgMCFSolver::MaxNodes::get()
+{
+	return solver()->MCFnmax();
+}
+
+unsigned int MgCS2::MgMCFSolver::MaxArcs::get()
+{
+	return solver()->MCFmmax();
+}
+
+unsigned int MgCS2::MgMCFSolver::PriceUpdateThreads::get()
+{
+	solver();
+	return priceUpdateThreads;
+}
+
+void MgCS2::MgMCFSolver::PriceUpdateThreads::set(unsigned int value)
+{
+	if (value == 0)
+		throw gcnew ArgumentOutOfRangeException("value");
+	solver()->SetPriceUpdateThreads(value);
+	priceUpdateThreads = value;
+}
+
+unsigned int MgCS2::MgMCFSolver::LoadThreads::get()
+{
+	solver();
+	return loadThreads;
+}
+
+void MgCS2::MgMCFSolver::LoadThreads::set(unsigned int value)
+{
+	if (value == 0)
+		throw gcnew ArgumentOutOfRangeException("value");
+	solver()->SetLoadThreads(value);
+	loadThreads = value;
+}
+
+void MgCS2::MgMCFSolver::SetRefine(MgRefine mode, unsigned int threads)
+{
+	if (threads == 0)
+		throw gcnew ArgumentOutOfRangeException("threads");
+	switch (mode)
+	{
+	case MgRefine::FIFO:
+		solver()->SetRefine(CS2Base::kFIFORefine, threads);
+		break;
+	case MgRefine::Waves:
+		solver()->SetRefine(CS2Base::kWaveRefine, threads);
+		break;
+	default:
+		throw gcnew ArgumentOutOfRangeException("mode");
+	}
+}
+
+void MgCS2::MgMCFSolver::SetMemory(bool hugePages, int numaNode)
+{
+	solver()->SetMemory(hugePages ? TRUE : FALSE, numaNode);
+}
+
+MgCS2::MgCS2Params MgCS2::MgMCFSolver::Params::get()
+{
+	return fromNative(solver()->GetParams());
+}
+
+void MgCS2::MgMCFSolver::Params::set(MgCS2Params value)
+{
+	if (value.ScaleFactor < 2)
+		throw gcnew ArgumentOutOfRangeException("value", "ScaleFactor must be at least 2");
+	if (value.PriceOutStart < 1)
+		throw gcnew ArgumentOutOfRangeException("value", "PriceOutStart must be at least 1");
+	if (value.UpdtFreqS < 0)
+		throw gcnew ArgumentOutOfRangeException("value", "UpdtFreqS must not be negative");
+	if (value.TimeForPriceIn1 < 0 || value.TimeForPriceIn1 > 127 || value.TimeForPriceIn2 < 0 || value.TimeForPriceIn2 > 127 || value.TimeForPriceIn3 < 0 || value.TimeForPriceIn3 > 127)
+		throw gcnew ArgumentOutOfRangeException("value", "TimeForPriceIn1..3 must be in 0 .. 127");
+	solver()->SetParams(toNative(value));
+}
+
+MgCS2::MgCS2Params MgCS2::MgMCFSolver::fromNative(const CS2Base::CS2Params &par)
+{
+	MgCS2Params p;
+	p.UpdtFreq = par.UpdtFreq;
+	p.UpdtFreqS = int(par.UpdtFreqS);
+	p.ScaleFactor = int(par.ScaleFactor);
+	p.PriceOutStart = int(par.PriceOutStart);
+	p.CutOffPower = par.CutOffPower;
+	p.CutOffCoef = par.CutOffCoef;
+	p.CutOffPower2 = par.CutOffPower2;
+	p.CutOffCoef2 = par.CutOffCoef2;
+	p.CutOffGap = par.CutOffGap;
+	p.CutOffMin = par.CutOffMin;
+	p.CutOffIncrease = par.CutOffIncrease;
+	p.TimeForPriceIn1 = par.TimeForPriceIn1;
+	p.TimeForPriceIn2 = par.TimeForPriceIn2;
+	p.TimeForPriceIn3 = par.TimeForPriceIn3;
+	return p;
+}
+
+CS2Base::CS2Params MgCS2::MgMCFSolver::toNative(MgCS2Params p)
+{
+	CS2Base::CS2Params par;
+	par.UpdtFreq = p.UpdtFreq;
+	par.UpdtFreqS = Index(p.UpdtFreqS);
+	par.ScaleFactor = Index(p.ScaleFactor);
+	par.PriceOutStart = Index(p.PriceOutStart);
+	par.CutOffPower = p.CutOffPower;
+	par.CutOffCoef = p.CutOffCoef;
+	par.CutOffPower2 = p.CutOffPower2;
+	par.CutOffCoef2 = p.CutOffCoef2;
+	par.CutOffGap = p.CutOffGap;
+	par.CutOffMin = p.CutOffMin;
+	par.CutOffIncrease = p.CutOffIncrease;
+	par.TimeForPriceIn1 = char(p.TimeForPriceIn1);
+	par.TimeForPriceIn2 = char(p.TimeForPriceIn2);
+	par.TimeForPriceIn3 = char(p.TimeForPriceIn3);
+	return par;
+}
+
+MgCS2::MgCS2Params MgCS2::MgCS2Params::Default::get()
+{
+	return MgMCFSolver::fromNative(CS2Base::CS2Params());
+}
+
+String^ MgCS2::MgCS2Params::ToString()
+{
+	Text::StringBuilder^ s = gcnew Text::StringBuilder();
+	s->AppendFormat("UpdtFreq={0} UpdtFreqS={1} ScaleFactor={2} PriceOutStart={3} ", UpdtFreq, UpdtFreqS, ScaleFactor, PriceOutStart);
+	s->AppendFormat("CutOffPower={0} CutOffCoef={1} CutOffPower2={2} CutOffCoef2={3} ", CutOffPower, CutOffCoef, CutOffPower2, CutOffCoef2);
+	s->AppendFormat("CutOffGap={0} CutOffMin={1} CutOffIncrease={2} ", CutOffGap, CutOffMin, CutOffIncrease);
+	s->AppendFormat("TimeForPriceIn={0},{1},{2}", TimeForPriceIn1, TimeForPriceIn2, TimeForPriceIn3);
+	return s->ToString();
+}
+
+// The file names are passed to the native code in the ANSI code page, and
+// the exceptions of the native loaders and writers are turned into
+// InvalidDataException.
+void MgCS2::MgMCFSolver::LoadBinary(String^ fileName)
+{
+	CS2Base *s = solver();
+	IntPtr name = Runtime::InteropServices::Marshal::StringToHGlobalAnsi(fileName);
+	try
+	{
+		s->LoadBin(static_cast<const char *>(name.ToPointer()));
+	}
+	catch (MCFClass::MCFException &e)
+	{
+		throw gcnew IO::InvalidDataException(fileName + ": " + gcnew String(e.what()));
+	}
+	finally
+	{
+		Runtime::InteropServices::Marshal::FreeHGlobal(name);
+	}
+}
+
+void MgCS2::MgMCFSolver::LoadDimacs(String^ fileName)
+{
+	CS2Base *s = solver();
+	IntPtr name = Runtime::InteropServices::Marshal::StringToHGlobalAnsi(fileName);
+	try
+	{
+		s->LoadDMX(static_cast<const char *>(name.ToPointer()));
+	}
+	catch (MCFClass::MCFException &e)
+	{
+		throw gcnew IO::InvalidDataException(fileName + ": " + gcnew String(e.what()));
+	}
+	finally
+	{
+		Runtime::InteropServices::Marshal::FreeHGlobal(name);
+	}
+}
+
+MgCS2::MgLoadStatistics MgCS2::MgMCFSolver::GetLoadStatistics()
+{
+	const CS2Base::CS2LoadStats &st = solver()->GetLoadStatistics();
+	MgLoadStatistics s;
+	s.Bytes = st.Bytes;
+	s.ReadTime = st.ReadTime;
+	s.Time = st.Time;
+	return s;
+}
+
+String^ MgCS2::MgLoadStatistics::ToString()
+{
+	return String::Format("{0:F1}MB in {1:F4}s ({2:F4}s reading, {3:F1}MB/s)", Bytes / 1e6, Time, ReadTime, MBPerSecond);
+}
+
+void MgCS2::MgMCFSolver::WriteBinary(String^ fileName)
 {
-	double* pU = new double[ pm ];
-	double* pC = new double[ pm ];
-	double* pDfct = new double[ pn ];
-	unsigned int* pSn = new unsigned int[ pm ];
-	unsigned  int* pEn = new unsigned int[ pm ];
-	for (unsigned int i=0; i < pm; i++)
+	WriteBinary(fileName, false);
+}
+
+void MgCS2::MgMCFSolver::WriteBinary(String^ fileName, bool pack)
+{
+	CS2Base *s = solver();
+	IntPtr name = Runtime::InteropServices::Marshal::StringToHGlobalAnsi(fileName);
+	try
 	{
-		pU[i] = pUA[i];
-		pC[i] = pCA[i];
-		pSn[i] = pSnA[i];
-		pEn[i] = pEnA[i];
+		std::ofstream out(static_cast<const char *>(name.ToPointer()), std::ios::binary);
+		s->SaveBin(out, pack);
+		if (!out)
+			throw gcnew IO::IOException("cannot write " + fileName);
 	}
-	for (unsigned int i=0; i < pn; i++)
+	finally
 	{
-		pDfct[i] = pDfctA[i];
+		Runtime::InteropServices::Marshal::FreeHGlobal(name);
+	}
+}
+
+void MgCS2::MgMCFSolver::ConvertDimacs(String^ dimacsFile, String^ binaryFile)
+{
+	CS2 s;
+	IntPtr name = Runtime::InteropServices::Marshal::StringToHGlobalAnsi(dimacsFile);
+	try
+	{
+		s.LoadDMX(static_cast<const char *>(name.ToPointer()));
+	}
+	catch (MCFClass::MCFException &e)
+	{
+		throw gcnew IO::InvalidDataException(dimacsFile + ": " + gcnew String(e.what()));
+	}
+	finally
+	{
+		Runtime::InteropServices::Marshal::FreeHGlobal(name);
+	}
+
+	name = Runtime::InteropServices::Marshal::StringToHGlobalAnsi(binaryFile);
+	try
+	{
+		std::ofstream out(static_cast<const char *>(name.ToPointer()), std::ios::binary);
+		s.WriteMCF(out, MCFClass::kBinary);
+		if (!out)
+			throw gcnew IO::IOException("cannot write " + binaryFile);
+	}
+	finally
+	{
+		Runtime::InteropServices::Marshal::FreeHGlobal(name);
+	}
+}
+
+// The managed arrays are pinned for the duration of the load and handed
+// straight to CS2::LoadNet, which copies them into its own arcs[] and
+// nodes[]; no intermediate native buffers are needed. A null capacity, cost
+// or deficit array is passed on as a null pointer, with the usual LoadNet
+// meaning (infinite capacities, zero costs, zero deficits).
+void MgCS2::MgMCFSolver::loadNet(unsigned int pn, unsigned int pm, array<double>^ pUA, array<double>^ pCA, array<double>^ pDfctA, array<unsigned int>^ pSnA, array<unsigned int>^ pEnA)
+{
+	if (pSnA == nullptr || pEnA == nullptr || unsigned(pSnA->Length) < pm || unsigned(pEnA->Length) < pm)
+		throw gcnew ArgumentException("start and end node arrays must hold pm entries");
+	if ((pUA != nullptr && unsigned(pUA->Length) < pm) || (pCA != nullptr && unsigned(pCA->Length) < pm))
+		throw gcnew ArgumentException("capacity and cost arrays must hold pm entries");
+	if (pDfctA != nullptr && unsigned(pDfctA->Length) < pn)
+		throw gcnew ArgumentException("deficit array must hold pn entries");
+
+	pin_ptr<double> pU = nullptr;
+	pin_ptr<double> pC = nullptr;
+	pin_ptr<double> pDfct = nullptr;
+	pin_ptr<unsigned int> pSn = nullptr;
+	pin_ptr<unsigned int> pEn = nullptr;
+	if (pUA != nullptr && pm)
+		pU = &pUA[0];
+	if (pCA != nullptr && pm)
+		pC = &pCA[0];
+	if (pDfctA != nullptr && pn)
+		pDfct = &pDfctA[0];
+	if (pm)
+	{
+		pSn = &pSnA[0];
+		pEn = &pEnA[0];
 	}
 	MgMCFSolver::initMgMCFSolver(pn, pm, pU, pC, pDfct, pSn, pEn);
 }
 
-void MgCS2::MgMCFSolver::initMgMCFSolver(unsigned int pn, unsigned int pm, double pU[], double pC[], double pDfct[], unsigned int pSn[], unsigned int pEn[])
+// Loads the network into mcf, keeping its current nmax/mmax (and hence its
+// arcs[], nodes[] and buckets[]) whenever the network fits.
+void MgCS2::MgMCFSolver::initMgMCFSolver(unsigned int pn, unsigned int pm, const double pU[], const double pC[], const double pDfct[], const unsigned int pSn[], const unsigned int pEn[])
 {
-	MgCS2::MgMCFSolver::mcf = new CS2(pn, pm);
-	mcf->LoadNet(pn, pm, pn, pm, pU, pC, pDfct, pSn, pEn);
+	Index nmx = mcf->MCFnmax();
+	Index mmx = mcf->MCFmmax();
+	if (pn > nmx)
+		nmx = pn;
+	if (pm > mmx)
+		mmx = pm;
+	mcf->LoadNet(nmx, mmx, pn, pm, pU, pC, pDfct, pSn, pEn);
    #if( EPS_FLOW && ( Ftype == REAL_TYPE ) )
    FNumber eF = 1;
    for( register Index i = mcf->MCFm() ; i-- ; )
@@ -55,27 +429,654 @@ void MgCS2::MgMCFSolver::initMgMCFSolver(unsigned int pn, unsigned int pm, doubl
   #endif
 }
 
+void MgCS2::MgMCFSolver::checkIndices(array<int>^ indices, unsigned int count)
+{
+	if (indices == nullptr)
+		throw gcnew ArgumentNullException("indices");
+	for (int k=0; k < indices->Length; k++)
+		if (indices[k] < 0 || unsigned(indices[k]) >= count)
+			throw gcnew ArgumentOutOfRangeException("indices");
+}
+
+void MgCS2::MgMCFSolver::checkChanges(array<int>^ indices, array<double>^ values, unsigned int count)
+{
+	checkIndices(indices, count);
+	if (values == nullptr || values->Length < indices->Length)
+		throw gcnew ArgumentException("values must hold one entry per index");
+}
+
+void MgCS2::MgMCFSolver::ChangeCosts(array<int>^ indices, array<double>^ values)
+{
+	MCFClass *s = solver();
+	checkChanges(indices, values, s->MCFm());
+	for (int k=0; k < indices->Length; k++)
+		s->ChgCost(indices[k], values[k]);
+}
+
+void MgCS2::MgMCFSolver::ChangeCapacities(array<int>^ indices, array<double>^ values)
+{
+	MCFClass *s = solver();
+	checkChanges(indices, values, s->MCFm());
+	for (int k=0; k < indices->Length; k++)
+		s->ChgUCap(indices[k], values[k]);
+}
+
+void MgCS2::MgMCFSolver::ChangeDeficits(array<int>^ indices, array<double>^ values)
+{
+	MCFClass *s = solver();
+	checkChanges(indices, values, s->MCFn());
+	for (int k=0; k < indices->Length; k++)
+		s->ChgDfct(indices[k], values[k]);
+}
+
+void MgCS2::MgMCFSolver::CloseArcs(array<int>^ indices)
+{
+	MCFClass *s = solver();
+	checkIndices(indices, s->MCFm());
+	for (int k=0; k < indices->Length; k++)
+		s->CloseArc(indices[k]);
+}
+
+void MgCS2::MgMCFSolver::OpenArcs(array<int>^ indices)
+{
+	MCFClass *s = solver();
+	checkIndices(indices, s->MCFm());
+	for (int k=0; k < indices->Length; k++)
+		s->OpenArc(indices[k]);
+}
+
 void MgCS2::MgMCFSolver::SolveMCF()
 {
-	mcf->SolveMCF();
+	solver()->SolveMCF();
 }
 
 bool MgCS2::MgMCFSolver::HasSolution()
 {
-	return mcf->MCFGetStatus() == MCFClass::kOK;
+	return solver()->MCFGetStatus() == MCFClass::kOK;
+}
+
+MgCS2::MgCS2Statistics MgCS2::MgMCFSolver::GetStatistics()
+{
+	CS2Base::CS2Stats st = solver()->GetStatistics();
+	MgCS2Statistics s;
+	s.NRefine = st.NRefine;
+	s.NPush = st.NPush;
+	s.NRelabel = st.NRelabel;
+	s.NDischarge = st.NDischarge;
+	s.NWave = st.NWave;
+	s.NUpdate = st.NUpdate;
+	s.NScan = st.NScan;
+	s.NPRefine = st.NPRefine;
+	s.NPrScan = st.NPrScan;
+	s.NPrScan1 = st.NPrScan1;
+	s.NPrScan2 = st.NPrScan2;
+	s.Time = st.Time;
+	return s;
+}
+
+MgCS2::MgCS2State^ MgCS2::MgMCFSolver::GetState()
+{
+	return gcnew MgCS2State(solver()->MCFGetState());
+}
+
+void MgCS2::MgMCFSolver::PutState(MgCS2State^ state)
+{
+	CS2Base *s = solver();
+	if (state == nullptr)
+		throw gcnew ArgumentNullException("state");
+	try
+	{
+		s->MCFPutState(state->Native());
+	}
+	catch (MCFClass::MCFException &e)
+	{
+		throw gcnew ArgumentException(gcnew String(e.what()), "state");
+	}
+}
+
+MgCS2::MgCS2State::~MgCS2State()
+{
+	this->!MgCS2State();
+}
+
+MgCS2::MgCS2State::!MgCS2State()
+{
+	delete state;
+	state = 0;
+}
+
+MCFClass::MCFState *MgCS2::MgCS2State::Native()
+{
+	if (!state)
+		throw gcnew ObjectDisposedException("MgCS2State");
+	return state;
 }
 
-void MgCS2::MgMCFSolver::MCFGetX(double x[])
+void MgCS2::MgMCFSolver::SetTrace(bool on)
 {
-	mcf->MCFGetX( x );
+	solver()->SetTrace(on);
 }
 
+String^ MgCS2::MgMCFSolver::GetTrace(bool json)
+{
+	std::ostringstream s;
+	solver()->WriteTrace(s, json ? CS2Base::kTrJSON : CS2Base::kTrCSV);
+	return gcnew String(s.str().c_str());
+}
+
+String^ MgCS2::MgCS2Statistics::ToString()
+{
+	Text::StringBuilder^ s = gcnew Text::StringBuilder();
+	s->AppendFormat("time={0:F4}s refines={1} pushes={2} relabels={3} discharges={4} waves={5} ", Time, NRefine, NPush, NRelabel, NDischarge, NWave);
+	s->AppendFormat("updates={0} scans={1} price-refines={2} pr-scans={3},{4},{5}", NUpdate, NScan, NPRefine, NPrScan, NPrScan1, NPrScan2);
+	return s->ToString();
+}
+
+// The solver walks the paths into its own scratch space, so the array is
+// allocated once, with the length of the walk.
+void MgCS2::MgMCFSolver::ExtractPaths(array<int>^ sources, array<int>^% path, array<int>^% offsets)
+{
+	CS2Base *s = solver();
+	if (sources == nullptr)
+		throw gcnew ArgumentNullException("sources");
+	for (int k=0; k < sources->Length; k++)
+		if (sources[k] < 1 - USENAME0 || sources[k] > int(s->MCFn()) - USENAME0)
+			throw gcnew ArgumentOutOfRangeException("sources");
+
+	offsets = gcnew array<int>(sources->Length + 1);
+	offsets[0] = 0;
+	if (sources->Length == 0)
+	{
+		path = gcnew array<int>(0);
+		return;
+	}
+
+	pin_ptr<int> pSources = &sources[0];
+	pin_ptr<int> pOffsets = &offsets[0];
+	Index len = s->MCFGetPaths(reinterpret_cast<const Index *>(static_cast<int *>(pSources)), sources->Length,
+		0, reinterpret_cast<Index *>(static_cast<int *>(pOffsets)), 0);
+	cIndex_Set nodes = s->MCFGetPathNodes();
+	path = gcnew array<int>(int(len));
+	for (int k=0; k < int(len); k++)
+		path[k] = nodes[k];
+}
+
+// Writes the flows straight into the pinned array, at most xA->Length of
+// them.
 void MgCS2::MgMCFSolver::MCFGetX(array<double>^ xA)
 {
-    double* x = new double[ xA->Length ];
-	MgMCFSolver::MCFGetX(x);
-	for (int i=0; i<xA->Length; i++)
+	MCFClass *s = solver();
+	if (xA == nullptr)
+		throw gcnew ArgumentNullException("xA");
+	if (xA->Length == 0)
+		return;
+	pin_ptr<double> x = &xA[0];
+	s->MCFGetX(x, 0, 0, xA->Length);
+}
+
+// Only the arcs on the chosen paths of a routing network carry flow, so the
+// sparse form of MCFGetX() avoids copying millions of zeros; it needs room
+// for all the arcs (and the InINF terminator) though, hence the scratch
+// buffers, which only grow.
+void MgCS2::MgMCFSolver::GetNonzeroFlows(array<int>^% arcs, array<double>^% flows)
+{
+	MCFClass *s = solver();
+	const Index m = s->MCFm();
+	if (bufferSize < m + 1)
+	{
+		delete[] flowBuffer;
+		delete[] arcBuffer;
+		flowBuffer = 0;
+		arcBuffer = 0;
+		bufferSize = 0;
+		flowBuffer = new double[m + 1];
+		arcBuffer = new unsigned int[m + 1];
+		bufferSize = m + 1;
+	}
+	s->MCFGetX(flowBuffer, arcBuffer);
+
+	int count = 0;
+	while (arcBuffer[count] != InINF)
+		count++;
+	arcs = gcnew array<int>(count);
+	flows = gcnew array<double>(count);
+	for (int k=0; k < count; k++)
+	{
+		arcs[k] = arcBuffer[k];
+		flows[k] = flowBuffer[k];
+	}
+}
+
+void MgCS2::MgMCFSolver::MCFGetPi(array<double>^ piA)
+{
+	MCFClass *s = solver();
+	if (piA == nullptr)
+		throw gcnew ArgumentNullException("piA");
+	if (piA->Length == 0)
+		return;
+	pin_ptr<double> pi = &piA[0];
+	s->MCFGetPi(pi, 0, 0, piA->Length);
+}
+
+void MgCS2::MgMCFSolver::MCFGetRC(array<double>^ rcA)
+{
+	MCFClass *s = solver();
+	if (rcA == nullptr)
+		throw gcnew ArgumentNullException("rcA");
+	if (rcA->Length == 0)
+		return;
+	pin_ptr<double> rc = &rcA[0];
+	s->MCFGetRC(rc, 0, 0, rcA->Length);
+}
+
+// The index form of MCFClass::MCFGetRC() wants the arcs sorted and
+// terminated, so the arcs are asked for one at a time instead; it is still
+// a single transition from managed code.
+void MgCS2::MgMCFSolver::MCFGetRC(array<int>^ arcs, array<double>^ rcA)
+{
+	MCFClass *s = solver();
+	if (arcs == nullptr)
+		throw gcnew ArgumentNullException("arcs");
+	if (rcA == nullptr)
+		throw gcnew ArgumentNullException("rcA");
+	if (rcA->Length < arcs->Length)
+		throw gcnew ArgumentException("rcA is shorter than arcs");
+	if (arcs->Length == 0)
+		return;
+	const Index m = s->MCFm();
+	pin_ptr<int> pArcs = &arcs[0];
+	pin_ptr<double> rc = &rcA[0];
+	for (int k=0; k < arcs->Length; k++)
+	{
+		if (Index(pArcs[k]) >= m)
+			throw gcnew ArgumentOutOfRangeException("arcs");
+		rc[k] = s->MCFGetRC(Index(pArcs[k]));
+	}
+}
+
+// Each unit of flow of a removed arc a goes back around a residual cycle
+// through the reverse of a, whose reduced cost is -rc(a), and at most n - 1
+// other residual arcs, each of reduced cost at least -epsilon; cycles
+// through several removed arcs are counted once for each of them.
+double MgCS2::MgMCFSolver::EstimateRipUpCost(array<int>^ arcs)
+{
+	CS2Base *s = solver();
+	if (arcs == nullptr)
+		throw gcnew ArgumentNullException("arcs");
+	if (s->MCFGetStatus() != MCFClass::kOK)
+		throw gcnew InvalidOperationException("there is no solution");
+	const Index m = s->MCFm();
+	const double slack = double(s->MCFn() - 1) * s->GetEpsilon();
+	double cost = 0;
+	for each (int arc in arcs)
+	{
+		if (Index(arc) >= m)
+			throw gcnew ArgumentOutOfRangeException("arcs");
+		FNumber x;
+		s->MCFGetX(&x, 0, Index(arc), Index(arc) + 1);
+		if (x > 0)
+			cost -= x * (s->MCFGetRC(Index(arc)) + slack);
+	}
+	return cost > 0 ? cost : 0;
+}
+
+// The native cut needs room for all the nodes, as it is also the queue of
+// the visits; it is only asked for after a failed solve, so the buffer is
+// not kept.
+double MgCS2::MgMCFSolver::MCFGetUnfCut(array<int>^% nodes)
+{
+	MCFClass *s = solver();
+	std::vector<Index> cut(s->MCFn() + 1);
+	double deficit = s->MCFGetUnfCut(&cut[0]);
+
+	int count = 0;
+	while (cut[count] != InINF)
+		count++;
+	nodes = gcnew array<int>(count);
+	for (int k=0; k < count; k++)
+		nodes[k] = cut[k];
+	return deficit;
+}
+
+MgCS2::MgRoutingNetwork::MgRoutingNetwork()
+{
+	network = new RoutingNetwork();
+}
+
+MgCS2::MgRoutingNetwork::~MgRoutingNetwork()
+{
+	this->!MgRoutingNetwork();
+}
+
+MgCS2::MgRoutingNetwork::!MgRoutingNetwork()
+{
+	delete network;
+	network = 0;
+}
+
+const RoutingNetwork &MgCS2::MgRoutingNetwork::Native()
+{
+	if (!network)
+		throw gcnew ObjectDisposedException("MgRoutingNetwork");
+	return *network;
+}
+
+static void checkNodes(array<int>^ nodes, String^ name, int nodeCount)
+{
+	if (nodes == nullptr)
+		throw gcnew ArgumentNullException(name);
+	for (int k=0; k < nodes->Length; k++)
+		if (nodes[k] < 0 || nodes[k] >= nodeCount)
+			throw gcnew ArgumentOutOfRangeException(name);
+}
+
+// The arrays are validated here, so that the native builder can trust them,
+// then pinned and handed over as they are (int and Index have the same size).
+void MgCS2::MgRoutingNetwork::Build(int nX, int nY, int extraNodes, array<int>^ extraFirst, array<int>^ extraHeads, array<int>^ removedEdges, array<int>^ sources, array<int>^ targets)
+{
+	Native();
+	if (nX < 0 || nY < 0 || extraNodes < 0)
+		throw gcnew ArgumentOutOfRangeException("nX, nY and extraNodes must not be negative");
+	const int nodeCount = nX * nY + extraNodes;
+	if (extraFirst != nullptr)
 	{
-		xA[i] = x[i];
+		if (extraFirst->Length < nodeCount + 1 || extraFirst[0] != 0)
+			throw gcnew ArgumentException("extraFirst must hold NodeCount + 1 entries, starting from 0");
+		for (int v=0; v < nodeCount; v++)
+			if (extraFirst[v + 1] < extraFirst[v])
+				throw gcnew ArgumentException("extraFirst must be nondecreasing");
+		if (extraHeads == nullptr || extraHeads->Length < extraFirst[nodeCount])
+			throw gcnew ArgumentException("extraHeads must hold extraFirst[NodeCount] entries");
+		for (int k=0; k < extraFirst[nodeCount]; k++)
+			if (extraHeads[k] < 0 || extraHeads[k] >= nodeCount)
+				throw gcnew ArgumentOutOfRangeException("extraHeads");
+	}
+	if (removedEdges != nullptr && removedEdges->Length < (4 * nX * nY + 31) / 32)
+		throw gcnew ArgumentException("removedEdges must hold 4 * nX * nY bits");
+	checkNodes(sources, "sources", nodeCount);
+	checkNodes(targets, "targets", nodeCount);
+
+	pin_ptr<int> pExtraFirst = nullptr;
+	pin_ptr<int> pExtraHeads = nullptr;
+	pin_ptr<int> pRemoved = nullptr;
+	pin_ptr<int> pSources = nullptr;
+	pin_ptr<int> pTargets = nullptr;
+	if (extraFirst != nullptr)
+		pExtraFirst = &extraFirst[0];
+	if (extraHeads != nullptr && extraHeads->Length)
+		pExtraHeads = &extraHeads[0];
+	if (removedEdges != nullptr && removedEdges->Length)
+		pRemoved = &removedEdges[0];
+	if (sources->Length)
+		pSources = &sources[0];
+	if (targets->Length)
+		pTargets = &targets[0];
+	network->Build(nX, nY, extraNodes,
+		reinterpret_cast<const Index *>(static_cast<int *>(pExtraFirst)),
+		reinterpret_cast<const Index *>(static_cast<int *>(pExtraHeads)),
+		reinterpret_cast<const unsigned int *>(static_cast<int *>(pRemoved)),
+		reinterpret_cast<const Index *>(static_cast<int *>(pSources)), sources->Length,
+		reinterpret_cast<const Index *>(static_cast<int *>(pTargets)), targets->Length);
+}
+
+bool MgCS2::MgRoutingNetwork::SameTopology(MgRoutingNetwork^ other)
+{
+	if (other == nullptr)
+		throw gcnew ArgumentNullException("other");
+	return Native().SameTopology(other->Native());
+}
+
+int MgCS2::MgRoutingNetwork::NodeCount::get()
+{
+	return Native().NodeCount();
+}
+
+int MgCS2::MgRoutingNetwork::VertexCount::get()
+{
+	return Native().VertexCount();
+}
+
+int MgCS2::MgRoutingNetwork::ArcCount::get()
+{
+	return Native().ArcCount();
+}
+
+int MgCS2::MgRoutingNetwork::FirstArc(int v)
+{
+	const RoutingNetwork &net = Native();
+	if (v < 0 || unsigned(v) > net.NodeCount())
+		throw gcnew ArgumentOutOfRangeException("v");
+	return net.FirstArc(v);
+}
+
+int MgCS2::MgRoutingNetwork::ArcHeadNode(int arc)
+{
+	const RoutingNetwork &net = Native();
+	if (arc < 0 || unsigned(arc) >= net.ArcCount())
+		throw gcnew ArgumentOutOfRangeException("arc");
+	Index node = net.ArcHeadNode(arc);
+	return node == InINF ? -1 : int(node);
+}
+
+// The values tried by MgCS2Tuner::Tune for each parameter, in the order in
+// which the parameters are swept; the defaults are among them.
+static const int tuneParams = 7;
+static const int tuneCounts[tuneParams] = { 6, 5, 4, 5, 3, 3, 3 };
+static const double tuneValues[tuneParams][6] = {
+	{ 4, 8, 12, 20, 30, 50 },    // ScaleFactor
+	{ 0.1, 0.2, 0.4, 0.8, 1.6 }, // UpdtFreq
+	{ 5, 10, 30, 100 },          // UpdtFreqS
+	{ 1, 5, 10, 20, 1000 },      // PriceOutStart (1000: never price out)
+	{ 0.75, 1.5, 3 },            // CutOffCoef
+	{ 0.3, 0.44, 0.6 },          // CutOffPower
+	{ 0.6, 0.8, 0.9 }            // CutOffGap
+};
+
+static void setTuneParam(CS2Base::CS2Params &par, int k, double value)
+{
+	switch (k)
+	{
+	case 0: par.ScaleFactor = Index(value); break;
+	case 1: par.UpdtFreq = value; break;
+	case 2: par.UpdtFreqS = Index(value); break;
+	case 3: par.PriceOutStart = Index(value); break;
+	case 4: par.CutOffCoef = value; break;
+	case 5: par.CutOffPower = value; break;
+	case 6: par.CutOffGap = value; break;
+	}
+}
+
+String^ MgCS2::MgCS2Tuner::Tune(array<String^>^ files, MgMCFNumbers numbers, int reps)
+{
+	if (files == nullptr)
+		throw gcnew ArgumentNullException("files");
+	if (reps < 1)
+		throw gcnew ArgumentOutOfRangeException("reps");
+
+	// group the files by family, in order of first appearance
+	Collections::Generic::List<String^>^ families = gcnew Collections::Generic::List<String^>();
+	Collections::Generic::Dictionary<String^, Collections::Generic::List<String^>^>^ members = gcnew Collections::Generic::Dictionary<String^, Collections::Generic::List<String^>^>();
+	for each (String^ file in files)
+	{
+		String^ family = IO::Path::GetFileName(IO::Path::GetDirectoryName(IO::Path::GetFullPath(file)));
+		if (!members->ContainsKey(family))
+		{
+			families->Add(family);
+			members->Add(family, gcnew Collections::Generic::List<String^>());
+		}
+		members[family]->Add(file);
+	}
+
+	Text::StringBuilder^ report = gcnew Text::StringBuilder();
+	CS2Base *mcf = MgMCFSolver::newSolver(numbers, 0, 0);
+	try
+	{
+		for each (String^ family in families)
+		{
+			std::vector<std::string> instances;
+			for each (String^ file in members[family])
+			{
+				array<Byte>^ bytes = IO::File::ReadAllBytes(file);
+				if (bytes->Length == 0)
+					throw gcnew IO::InvalidDataException(file + " is empty");
+				pin_ptr<Byte> pBytes = &bytes[0];
+				instances.push_back(std::string(reinterpret_cast<const char *>(pBytes), bytes->Length));
+			}
+
+			// the default parameters give the reference objectives; the
+			// instances they do not solve to optimality are left out, and
+			// listed in the report
+			CS2Base::CS2Params best;
+			mcf->SetParams(best);
+			std::vector<std::string> solved;
+			Collections::Generic::List<String^>^ skipped = gcnew Collections::Generic::List<String^>();
+			for (size_t i = 0; i < instances.size(); i++)
+			{
+				std::istringstream in(instances[i]);
+				mcf->LoadDMX(in);
+				mcf->SolveMCF();
+				if (mcf->MCFGetStatus() == MCFClass::kOK)
+					solved.push_back(instances[i]);
+				else
+					skipped->Add(IO::Path::GetFileName(members[family][int(i)]));
+			}
+			if (skipped->Count > 0)
+			{
+				report->AppendFormat("{0}: skipped {1}, not solved with the default parameters", family, String::Join(", ", skipped->ToArray()));
+				report->AppendLine();
+			}
+			if (solved.empty())
+				continue;
+			instances.swap(solved);
+
+			std::vector<double> objs;
+			double defaultTime = solveTime(mcf, instances, objs, reps);
+			if (defaultTime < 0)
+				throw gcnew InvalidOperationException(family + ": the default parameters do not solve the instances consistently");
+			double bestTime = defaultTime;
+			for (int k = 0; k < tuneParams; k++)
+				for (int v = 0; v < tuneCounts[k]; v++)
+				{
+					CS2Base::CS2Params par = best;
+					setTuneParam(par, k, tuneValues[k][v]);
+					mcf->SetParams(par);
+					double time = solveTime(mcf, instances, objs, reps);
+					if (time >= 0 && time < bestTime)
+					{
+						best = par;
+						bestTime = time;
+					}
+				}
+
+			report->AppendFormat("{0}: {1} instances, default {2:F3} s, best {3:F3} s with {4}", family, int(instances.size()), defaultTime, bestTime, MgMCFSolver::fromNative(best));
+			report->AppendLine();
+		}
+	}
+	catch (MCFClass::MCFException &e)
+	{
+		throw gcnew IO::InvalidDataException(gcnew String(e.what()));
+	}
+	finally
+	{
+		delete mcf;
+	}
+	return report->ToString();
+}
+
+// Returns the total over the instances of the best of reps solve times, in
+// seconds, or -1 if some instance is not solved to the objective in objs;
+// the objectives of the instances not in objs yet are appended to it.
+double MgCS2::MgCS2Tuner::solveTime(CS2Base *mcf, const std::vector<std::string> &instances, std::vector<double> &objs, int reps)
+{
+	double total = 0;
+	for (size_t i = 0; i < instances.size(); i++)
+	{
+		double best = -1;
+		for (int r = 0; r < reps; r++)
+		{
+			std::istringstream in(instances[i]);
+			mcf->LoadDMX(in);
+			Diagnostics::Stopwatch^ watch = Diagnostics::Stopwatch::StartNew();
+			mcf->SolveMCF();
+			double time = watch->Elapsed.TotalSeconds;
+			if (mcf->MCFGetStatus() != MCFClass::kOK)
+				return -1;
+			double obj = double(mcf->MCFGetFO());
+			if (i == objs.size())
+				objs.push_back(obj);
+			if (ABS(obj - objs[i]) > 1e-9 * (1 + ABS(objs[i])))
+				return -1;
+			if (best < 0 || time < best)
+				best = time;
+		}
+		total += best;
+	}
+	return total;
+}
+
+// The random networks of MgCS2Benchmark::LoadNet: tails and heads uniform
+// over n = m / 4 nodes, costs in [0, 100), capacities in [1, 10], from a
+// fixed xorshift sequence so that runs can be compared.
+static unsigned long long nextRandom(unsigned long long &x)
+{
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	return x;
+}
+
+String^ MgCS2::MgCS2Benchmark::LoadNet(array<int>^ arcCounts, MgMCFNumbers numbers, unsigned int threads, int reps)
+{
+	if (arcCounts == nullptr)
+		throw gcnew ArgumentNullException("arcCounts");
+	if (threads == 0)
+		throw gcnew ArgumentOutOfRangeException("threads");
+	if (reps < 1)
+		throw gcnew ArgumentOutOfRangeException("reps");
+
+	Text::StringBuilder^ report = gcnew Text::StringBuilder();
+	for each (int count in arcCounts)
+	{
+		if (count < 4)
+			throw gcnew ArgumentOutOfRangeException("arcCounts");
+		Index m = Index(count);
+		Index n = m / 4;
+		std::vector<double> caps(m), costs(m);
+		std::vector<Index> tails(m), heads(m);
+		unsigned long long x = 88172645463325252ULL;
+		for (Index i = 0; i < m; i++)
+		{
+			tails[i] = Index(nextRandom(x) % n) + 1;
+			heads[i] = Index(nextRandom(x) % n) + 1;
+			costs[i] = double(x % 100);
+			caps[i] = double(1 + (x >> 20) % 10);
+		}
+
+		double times[2];
+		CS2Base *mcf = MgMCFSolver::newSolver(numbers, 0, 0);
+		try
+		{
+			for (int k = 0; k < 2; k++)
+			{
+				mcf->SetLoadThreads(k ? threads : 1);
+				times[k] = -1;
+				for (int r = 0; r < reps; r++)
+				{
+					Diagnostics::Stopwatch^ watch = Diagnostics::Stopwatch::StartNew();
+					mcf->LoadNet(n, m, n, m, &caps[0], &costs[0], 0, &tails[0], &heads[0]);
+					double time = watch->Elapsed.TotalSeconds;
+					if (times[k] < 0 || time < times[k])
+						times[k] = time;
+				}
+			}
+		}
+		finally
+		{
+			delete mcf;
+		}
+
+		report->AppendFormat("{0} arcs, {1} nodes: {2:F3} s with 1 thread ({3:F1} M arcs/s), {4:F3} s with {5} ({6:F1} M arcs/s)", m, n, times[0], m / times[0] / 1e6, times[1], threads, m / times[1] / 1e6);
+		report->AppendLine();
 	}
+	return report->ToString();
 }
\ No newline at end of file
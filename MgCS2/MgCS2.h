@@ -2,25 +2,360 @@
 
 #pragma once
 
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
 #include "CS2.h"
+#include "RoutingNetwork.h"
 
 using namespace System;
 
 namespace MgCS2 {
 
+	/// The split-node min cost flow network of a routing grid, built natively
+	/// in forward-star order (see RoutingNetwork.h), ready to be loaded into
+	/// an MgMCFSolver. Grid nodes are numbered x + y * nX, followed by the
+	/// extra nodes.
+	public ref class MgRoutingNetwork
+	{
+	public:
+		MgRoutingNetwork();
+		~MgRoutingNetwork();
+		!MgRoutingNetwork();
+
+		/// Builds the network of an nX by nY manhattan grid with extraNodes
+		/// extra nodes. The extra edges of node v go to the nodes
+		/// extraHeads[extraFirst[v]] .. extraHeads[extraFirst[v + 1] - 1]
+		/// (both arrays may be null if there are no extra edges). Bit
+		/// 4 * v + d of removedEdges (as filled by BitArray.CopyTo, may be
+		/// null) removes the grid edge of node v in direction d, with
+		/// directions +x, +y, -x, -y. The buffers are reused by later builds.
+		void Build(int nX, int nY, int extraNodes, array<int>^ extraFirst, array<int>^ extraHeads, array<int>^ removedEdges, array<int>^ sources, array<int>^ targets);
+
+		/// Whether the other network only differs from this one in its
+		/// removed grid edges, so that MgMCFSolver::Update can switch from
+		/// one to the other.
+		bool SameTopology(MgRoutingNetwork^ other);
+
+		property int NodeCount { int get(); }
+		property int VertexCount { int get(); }
+		property int ArcCount { int get(); }
+
+		/// The arcs leaving node v are FirstArc(v) .. FirstArc(v + 1) - 1,
+		/// for 0 <= v < NodeCount.
+		int FirstArc(int v);
+		/// The node entered by an arc leaving a node, or -1 if the arc goes
+		/// to the super sink.
+		int ArcHeadNode(int arc);
+
+	internal:
+		const RoutingNetwork &Native();
+
+	private:
+		RoutingNetwork *network;
+	};
+
+	/// The types of the flows and costs inside an MgMCFSolver: Double is
+	/// the plain CS2, while Int32 and Int64 are the integer instantiations
+	/// (see CS2T in CS2.h), which compare exactly, without the epsilons of
+	/// the floating point one. The integer ones must only be given integer
+	/// capacities, costs and deficits, as those of routing networks.
+	public enum class MgMCFNumbers
+	{
+		Double,
+		Int32,
+		Int64
+	};
+
+	/// The refine strategies of the solver (see CS2Base::SetRefine): FIFO
+	/// is the sequential push-relabel of the original CS2, Waves the
+	/// synchronous one, whose pushes and relabels run on several threads.
+	public enum class MgRefine
+	{
+		FIFO,
+		Waves
+	};
+
+	/// The parameters of the heuristics of the solver, with the names and
+	/// meaning of CS2Base::CS2Params. Default holds those of the original
+	/// CS2, which were tuned on transportation problems rather than on
+	/// unit capacity routing networks.
+	public value struct MgCS2Params
+	{
+		double UpdtFreq;
+		int UpdtFreqS;
+		int ScaleFactor;
+		int PriceOutStart;
+		double CutOffPower;
+		double CutOffCoef;
+		double CutOffPower2;
+		double CutOffCoef2;
+		double CutOffGap;
+		double CutOffMin;
+		double CutOffIncrease;
+		int TimeForPriceIn1;
+		int TimeForPriceIn2;
+		int TimeForPriceIn3;
+
+		static property MgCS2Params Default { MgCS2Params get(); }
+		virtual String^ ToString() override;
+	};
+
+	/// The statistics of the last SolveMCF() of a solver, with the names and
+	/// meaning of CS2Base::CS2Stats; Time is in seconds.
+	public value struct MgCS2Statistics
+	{
+		long long NRefine;
+		long long NPush;
+		long long NRelabel;
+		long long NDischarge;
+		long long NWave;
+		long long NUpdate;
+		long long NScan;
+		long long NPRefine;
+		long long NPrScan;
+		long long NPrScan1;
+		long long NPrScan2;
+		double Time;
+
+		virtual String^ ToString() override;
+	};
+
+	/// The last load of a solver from a file, with the names and meaning of
+	/// CS2Base::CS2LoadStats; times are in seconds.
+	public value struct MgLoadStatistics
+	{
+		double Bytes;
+		double ReadTime;
+		double Time;
+
+		/// The throughput of the whole load, in megabytes per second.
+		property double MBPerSecond
+		{
+			double get() { return Time > 0 ? Bytes / 1e6 / Time : 0; }
+		}
+
+		virtual String^ ToString() override;
+	};
+
+	/// A solution saved by MgMCFSolver::GetState, to be put back by
+	/// MgMCFSolver::PutState any number of times; it holds native memory
+	/// (a flow per arc and a price per node) until disposed.
+	public ref class MgCS2State
+	{
+	public:
+		~MgCS2State();
+		!MgCS2State();
+
+	internal:
+		MgCS2State(MCFClass::MCFState *s) : state(s) {}
+		MCFClass::MCFState *Native();
+
+	private:
+		MCFClass::MCFState *state;
+	};
+
 	public ref class MgMCFSolver
 	{
 	public:
+		MgMCFSolver();
+		MgMCFSolver(MgMCFNumbers numbers);
 		MgMCFSolver(unsigned int pn, unsigned int pm, array<double>^ pUA, array<double>^ pCA, array<double>^ pDfctA, array<unsigned int>^ pSnA, array<unsigned int>^ pEnA);
+		~MgMCFSolver();
+		!MgMCFSolver();
+
+		/// Loads a new network into this solver. The native buffers are kept
+		/// and reused when the network has at most MaxNodes nodes and MaxArcs
+		/// arcs; otherwise they are reallocated with the larger sizes.
+		void Reload(unsigned int pn, unsigned int pm, array<double>^ pUA, array<double>^ pCA, array<double>^ pDfctA, array<unsigned int>^ pSnA, array<unsigned int>^ pEnA);
+		/// Loads a routing network, with its removed grid edges closed.
+		/// Needs the dynamic topology build of CS2 (DYNMC_MCF_CS2 > 0).
+		void Reload(MgRoutingNetwork^ network);
+		/// Switches the loaded routing network previous to next, which must
+		/// have the same topology, by only opening and closing the arcs of
+		/// the grid edges whose removal changed; the next SolveMCF() is
+		/// warm-started.
+		void Update(MgRoutingNetwork^ previous, MgRoutingNetwork^ next);
+		/// Loads an instance in the binary format of MCFClass::MCFBinHeader
+		/// (see CS2Base::LoadBin), which is memory-mapped rather than parsed;
+		/// the buffers are resized to the instance.
+		void LoadBinary(String^ fileName);
+		/// Loads an instance in DIMACS format, parsing the memory-mapped file
+		/// in place (see CS2Base::LoadDMX); the buffers are resized to the
+		/// instance.
+		void LoadDimacs(String^ fileName);
+		/// The size, time and throughput of the last LoadBinary() or
+		/// LoadDimacs().
+		MgLoadStatistics GetLoadStatistics();
+		/// Writes the loaded network in the binary format, e.g. to capture
+		/// a slow instance for later regression runs.
+		void WriteBinary(String^ fileName);
+		/// As WriteBinary(fileName), but if pack the file is compressed (see
+		/// CS2Base::SaveBin); cheap enough for capturing every instance.
+		/// Packed files are read by LoadBinary, but not memory-mapped.
+		void WriteBinary(String^ fileName, bool pack);
+		/// Converts an instance from DIMACS to the binary format.
+		static void ConvertDimacs(String^ dimacsFile, String^ binaryFile);
+		property unsigned int MaxNodes { unsigned int get(); }
+		property unsigned int MaxArcs { unsigned int get(); }
+
+		/// The number of threads of the price update heuristic of the
+		/// solver (see CS2Base::SetPriceUpdateThreads), 1 by default.
+		property unsigned int PriceUpdateThreads { unsigned int get(); void set(unsigned int value); }
+
+		/// The number of threads that build the forward stars of each loaded
+		/// network (see CS2Base::SetLoadThreads), 1 by default.
+		property unsigned int LoadThreads { unsigned int get(); void set(unsigned int value); }
+
+		/// Selects the refine strategy of the solver and, for Waves, the
+		/// number of its threads (see CS2Base::SetRefine); FIFO by default.
+		void SetRefine(MgRefine mode, unsigned int threads);
+
+		/// Selects how the working storage of the solver is obtained, from
+		/// the next load on (see CS2Base::SetMemory): as one block, of large
+		/// pages if hugePages and the system allows it, preferably on NUMA
+		/// node numaNode if it is not negative. Reloading a network of the
+		/// same size then allocates nothing.
+		void SetMemory(bool hugePages, int numaNode);
+
+		/// The parameters of the heuristics of the solver (see
+		/// CS2Base::SetParams), used from the next SolveMCF() on;
+		/// MgCS2Params::Default until set.
+		property MgCS2Params Params { MgCS2Params get(); void set(MgCS2Params value); }
+
+		/// Batched changes to the loaded network: values[i] becomes the cost
+		/// or capacity of arc indices[i], or the deficit of node indices[i].
+		/// The next SolveMCF() is warm-started from the current flow and
+		/// potentials instead of solving from scratch.
+		void ChangeCosts(array<int>^ indices, array<double>^ values);
+		void ChangeCapacities(array<int>^ indices, array<double>^ values);
+		void ChangeDeficits(array<int>^ indices, array<double>^ values);
+
+		/// Closes (removes from the network, until reopened) or reopens the
+		/// given arcs; the next SolveMCF() is warm-started. Needs the
+		/// dynamic topology build of CS2 (DYNMC_MCF_CS2 > 0).
+		void CloseArcs(array<int>^ indices);
+		void OpenArcs(array<int>^ indices);
+
 	    void SolveMCF();
 		bool HasSolution();
+		/// The counters and time of the last SolveMCF(), for logging; the
+		/// solver is always timed.
+		MgCS2Statistics GetStatistics();
+		/// Saves the current solution (flows, prices and epsilon), so that
+		/// what-if variants of the network can all start from it.
+		MgCS2State^ GetState();
+		/// Puts back a solution saved by GetState of this solver, with the
+		/// network it was saved with; SolveMCF() then warm-starts from it
+		/// (see CS2T::MCFPutState). When the network is unchanged, the
+		/// solution is available at once, with no solve; otherwise
+		/// HasSolution() is false until the next SolveMCF(). Typical use: put
+		/// the state back after restoring the base network (e.g. with
+		/// Update), and only then switch to the next variant.
+		void PutState(MgCS2State^ state);
+		/// Turns on or off the timing of the parts of each SolveMCF() (see
+		/// CS2Base::SetTrace); off by default.
+		void SetTrace(bool on);
+		/// The timing of the parts of the last SolveMCF(), as CSV or JSON
+		/// (see CS2Base::WriteTrace); with no records if the trace is off.
+		String^ GetTrace(bool json);
 		void MCFGetX(array<double>^ xA);
 
+		/// The nonzero flows of the solution, in sparse form: flows[i] is the
+		/// flow on arc arcs[i], with the arcs in increasing order. The
+		/// native scratch buffers are kept and reused by later calls.
+		void GetNonzeroFlows([System::Runtime::InteropServices::Out] array<int>^% arcs, [System::Runtime::InteropServices::Out] array<double>^% flows);
+
+		/// The dual solution, written straight into the given arrays (which
+		/// are pinned, not copied): the potentials of the first piA->Length
+		/// nodes, and the reduced costs of the first rcA->Length arcs (see
+		/// MCFClass::MCFGetPi and MCFGetRC).
+		void MCFGetPi(array<double>^ piA);
+		void MCFGetRC(array<double>^ rcA);
+		/// The reduced costs of the given arcs only, in any order: rcA[i] is
+		/// the reduced cost of arc arcs[i]. rcA needs room for all of them.
+		void MCFGetRC(array<int>^ arcs, array<double>^ rcA);
+		/// A lower bound on how much the optimal cost would grow if the
+		/// given arcs (e.g. those of a route to rip up) were removed,
+		/// without solving again; it is meant for pruning what-if
+		/// explorations. The flow on each removed arc a has to go around
+		/// residual cycles through the reverse of a, whose reduced cost is
+		/// -rc(a), while the other residual arcs have reduced costs of at
+		/// least -epsilon (see CS2Base::GetEpsilon); so the bound is the sum
+		/// of flow(a) * (-rc(a) - (n - 1) * epsilon), or 0 if that is
+		/// negative. Needs a solution (see HasSolution).
+		double EstimateRipUpCost(array<int>^ arcs);
+
+		/// When SolveMCF() finds the network unfeasible, the certificate of
+		/// it (see CS2T::MCFGetUnfCut): the nodes of a cut (names as in the
+		/// start and end node arrays, in increasing order) from which more
+		/// supply has to leave than the arcs leaving it can carry, so that
+		/// at least one of them needs more capacity. Returns the deficit of
+		/// the cut, which is then negative; otherwise the cut is empty and
+		/// 0 is returned. O(m), with no solve.
+		double MCFGetUnfCut([System::Runtime::InteropServices::Out] array<int>^% nodes);
+
+		/// Decomposes the flow into one unit path per source node (node
+		/// names as in the start and end node arrays) by walking the solver's
+		/// residual arcs: the nodes entered by the path of sources[i] are
+		/// path[offsets[i]] .. path[offsets[i + 1] - 1], up to the node where
+		/// the flow ends. Linear in the total length of the paths.
+		void ExtractPaths(array<int>^ sources, [System::Runtime::InteropServices::Out] array<int>^% path, [System::Runtime::InteropServices::Out] array<int>^% offsets);
+
+	internal:
+		static CS2Base *newSolver(MgMCFNumbers numbers, unsigned int nmx, unsigned int mmx);
+		static MgCS2Params fromNative(const CS2Base::CS2Params &par);
+		static CS2Base::CS2Params toNative(MgCS2Params par);
+
 	private:
-		void initMgMCFSolver(unsigned int pn, unsigned int pm, double pU[], double pC[], double pDfct[], unsigned int pSn[], unsigned int pEn[]);
-		void MCFGetX(double x[]);
+		void loadNet(unsigned int pn, unsigned int pm, array<double>^ pUA, array<double>^ pCA, array<double>^ pDfctA, array<unsigned int>^ pSnA, array<unsigned int>^ pEnA);
+		void initMgMCFSolver(unsigned int pn, unsigned int pm, const double pU[], const double pC[], const double pDfct[], const unsigned int pSn[], const unsigned int pEn[]);
+		CS2Base *solver();
+		static void checkIndices(array<int>^ indices, unsigned int count);
+		static void checkChanges(array<int>^ indices, array<double>^ values, unsigned int count);
 
 	private:
-		MCFClass *mcf;
+		CS2Base *mcf;
+		// scratch buffers of GetNonzeroFlows(), with room for bufferSize arcs
+		double *flowBuffer;
+		unsigned int *arcBuffer;
+		unsigned int bufferSize;
+		unsigned int priceUpdateThreads;
+		unsigned int loadThreads;
+	};
+
+	/// Tunes the parameters of the heuristics of the solver on a corpus of
+	/// instances in DIMACS format, by problem family: the family of an
+	/// instance is the name of the directory of its file.
+	public ref class MgCS2Tuner
+	{
+	public:
+		/// For each family, starts from MgCS2Params::Default and sweeps each
+		/// parameter in turn over a few values, keeping a value when it
+		/// lowers the total solve time of the instances of the family (the
+		/// best of reps cold solves each, loading excluded); settings that
+		/// change the optimal objective of an instance are rejected. The
+		/// instances that the default parameters do not solve to optimality
+		/// (e.g. unfeasible ones) are left out, and listed in the report;
+		/// a family with no other instance is not tuned. Returns a report
+		/// with the default and best times and the best parameters of each
+		/// family.
+		static String^ Tune(array<String^>^ files, MgMCFNumbers numbers, int reps);
+
+	private:
+		static double solveTime(CS2Base *mcf, const std::vector<std::string> &instances, std::vector<double> &objs, int reps);
+	};
+
+	/// Times the loading of networks into the solver on the machine at hand.
+	public ref class MgCS2Benchmark
+	{
+	public:
+		/// For each count in arcCounts, builds a random network with that
+		/// many arcs and a quarter as many nodes, and reports the best of
+		/// reps LoadNet() times with one load thread and with threads (see
+		/// CS2Base::SetLoadThreads), and the throughput in arcs per second.
+		static String^ LoadNet(array<int>^ arcCounts, MgMCFNumbers numbers, unsigned int threads, int reps);
 	};
 }
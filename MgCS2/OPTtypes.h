@@ -56,7 +56,9 @@
 
 /*---------------------------- OPT_TIMERS ----------------------------------*/
 
-#define OPT_TIMERS 5
+#ifndef OPT_TIMERS
+ #define OPT_TIMERS 7
+#endif
 
 /**< The class OPTtimers is defined below to give an abstract interface to the
    different timing routines that are used in different platforms. This is
@@ -79,6 +81,18 @@
 
    - 6 = Use the Unix gettimeofday() routine of sys/time.h.
 
+   - 7 = return wallclock time from a monotonic clock with (up to)
+         nanosecond resolution: std::chrono::steady_clock if the compiler
+         supports C++11, QueryPerformanceCounter() on older Windows
+         compilers, clock_gettime( CLOCK_MONOTONIC ) elsewhere; the ticks
+         are kept in 64 bits, so there is no rollover. This is the default,
+         as it still measures sub-millisecond runs.
+
+   - 8 = return the CPU time of the calling thread, split into user and
+         system time on Windows (GetThreadTimes()), as user time elsewhere
+         (clock_gettime( CLOCK_THREAD_CPUTIME_ID )); the timer must then be
+         started and read by the same thread.
+
    Any unsupported value would simply make the class to report constant
    zero as the time.
 
@@ -154,6 +168,27 @@
  #include <time.h>
 #elif( OPT_TIMERS == 6 )
  #include <sys/time.h>
+#elif( ( OPT_TIMERS == 7 ) && ( ( __cplusplus >= 201103L ) || \
+				( defined( _MSC_VER ) && ( _MSC_VER >= 1700 ) ) ) )
+ #include <chrono>
+ #define OPT_STEADY_CHRONO 1
+#elif( ( OPT_TIMERS == 7 ) || ( OPT_TIMERS == 8 ) )
+ #if( defined( _WIN32 ) )
+  /* <windows.h> clashes with BOOL, TRUE and FALSE below, so the few
+     kernel32 functions that are needed are declared here */
+  extern "C" {
+   __declspec( dllimport ) int __stdcall QueryPerformanceCounter(
+							  long long *cnt );
+   __declspec( dllimport ) int __stdcall QueryPerformanceFrequency(
+							  long long *frq );
+   __declspec( dllimport ) void * __stdcall GetCurrentThread( void );
+   __declspec( dllimport ) int __stdcall GetThreadTimes( void *thrd ,
+		 long long *crt , long long *ext , long long *krn ,
+		 long long *usr );
+   }
+ #else
+  #include <time.h>
+ #endif
 #endif
 
 /*- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
@@ -477,6 +512,10 @@ class OPTtimers {
      struct timeval t;
      gettimeofday( &t , NULL );
      t_u = double( t.tv_sec + t.tv_usec * 1e-6 );
+    #elif( OPT_TIMERS == 7 )
+     t_u = NanoTime();
+    #elif( OPT_TIMERS == 8 )
+     ThreadTimes( t_u , t_s );
     #endif
 
     ticking = 1;
@@ -523,6 +562,13 @@ class OPTtimers {
      struct timeval t;
      gettimeofday( &t , NULL );
      tu += double( t.tv_sec + t.tv_usec * 1e-6 ) - t_u;
+    #elif( OPT_TIMERS == 7 )
+     tu += double( NanoTime() - t_u ) * 1e-9;
+    #elif( OPT_TIMERS == 8 )
+     long long c_u , c_s;
+     ThreadTimes( c_u , c_s );
+     tu += double( c_u - t_u ) * 1e-9;
+     ts += double( c_s - t_s ) * 1e-9;
     #endif
     }
    else { tu += u; ts += s; }
@@ -552,6 +598,43 @@ class OPTtimers {
   #endif
  #elif( OPT_TIMERS == 6 )
   double t_u;
+ #elif( OPT_TIMERS == 7 )
+  long long t_u;  // nanoseconds on the monotonic clock
+
+  static long long NanoTime( void )
+  {
+   #if( OPT_STEADY_CHRONO )
+    return( std::chrono::duration_cast< std::chrono::nanoseconds >(
+		 std::chrono::steady_clock::now().time_since_epoch() ).count() );
+   #elif( defined( _WIN32 ) )
+    long long c , f;
+    QueryPerformanceCounter( &c );
+    QueryPerformanceFrequency( &f );
+    return( ( c / f ) * 1000000000LL + ( ( c % f ) * 1000000000LL ) / f );
+   #else
+    struct timespec t;
+    clock_gettime( CLOCK_MONOTONIC , &t );
+    return( t.tv_sec * 1000000000LL + t.tv_nsec );
+   #endif
+   }
+ #elif( OPT_TIMERS == 8 )
+  long long t_u;  // nanoseconds of user time of the thread
+  long long t_s;  // nanoseconds of system time of the thread
+
+  static void ThreadTimes( long long &tu , long long &ts )
+  {
+   #if( defined( _WIN32 ) )
+    long long crt , ext , krn , usr;  // in units of 100 nanoseconds
+    GetThreadTimes( GetCurrentThread() , &crt , &ext , &krn , &usr );
+    tu = usr * 100;
+    ts = krn * 100;
+   #else
+    struct timespec t;
+    clock_gettime( CLOCK_THREAD_CPUTIME_ID , &t );
+    tu = t.tv_sec * 1000000000LL + t.tv_nsec;
+    ts = 0;
+   #endif
+   }
  #endif
 
  };  // end( class OPTtimers );
@@ -0,0 +1,114 @@
+// RoutingNetwork.cpp
+
+#include "stdafx.h"
+
+#include "RoutingNetwork.h"
+
+static const int dX[] = { 1, 0, -1, 0 };
+static const int dY[] = { 0, 1, 0, -1 };
+
+RoutingNetwork::RoutingNetwork()
+	: nX(0), nY(0), nodeCount(0), n(0), m(0)
+{
+}
+
+inline void RoutingNetwork::addArc(Index tail, Index head, CNumber cost)
+{
+	Sn[m] = tail;
+	En[m] = head;
+	U[m] = 1;
+	C[m] = cost;
+	m++;
+}
+
+void RoutingNetwork::Build(Index pnX, Index pnY, Index nExtra, const Index pExtraFirst[], const Index pExtraHeads[], const unsigned int removed[], const Index pSources[], Index nSources, const Index pTargets[], Index nTargets)
+{
+	nX = pnX;
+	nY = pnY;
+	const Index nGrid = nX * nY;
+	nodeCount = nGrid + nExtra;
+	const Index N = nodeCount;
+
+	// remember the topology
+	if (pExtraFirst)
+	{
+		extraFirst.assign(pExtraFirst, pExtraFirst + N + 1);
+		extraHeads.assign(pExtraHeads, pExtraHeads + extraFirst[N]);
+	}
+	else
+	{
+		extraFirst.assign(N + 1, 0);
+		extraHeads.clear();
+	}
+	sources.assign(pSources, pSources + nSources);
+	targets.assign(pTargets, pTargets + nTargets);
+
+	// size the arrays: node arcs, extra edges, grid edges, super source and
+	// super sink arcs
+	std::vector<Index> &targetCount = outFirst;  // reused as scratch
+	targetCount.assign(N + 1, 0);
+	for (Index i = 0; i < nTargets; i++)
+		targetCount[targets[i]]++;
+
+	const Index gridArcs = nGrid ? 2 * ((nX - 1) * nY + nX * (nY - 1)) : 0;
+	const Index mTot = N + Index(extraHeads.size()) + gridArcs + nTargets + nSources;
+	n = 2 * N + 2;
+	U.resize(mTot);
+	C.resize(mTot);
+	Sn.resize(mTot);
+	En.resize(mTot);
+	Dfct.assign(n, 0);
+	closed.clear();
+
+	// node arcs
+	m = 0;
+	for (Index v = 0; v < N; v++)
+		addArc(v + 1, N + v + 1, 0);
+
+	// arcs leaving the outgoing vertices; outFirst[v] is overwritten only
+	// after targetCount[v] has been used
+	for (Index v = 0; v < N; v++)
+	{
+		const Index count = targetCount[v];
+		outFirst[v] = m;
+		const Index tail = N + v + 1;
+
+		for (Index k = extraFirst[v]; k < extraFirst[v + 1]; k++)
+			addArc(tail, extraHeads[k] + 1, 1);
+
+		if (v < nGrid)
+		{
+			const Index x = v % nX;
+			const Index y = v / nX;
+			for (Index d = 0; d < 4; d++)
+			{
+				const Index x2 = x + dX[d];
+				const Index y2 = y + dY[d];
+				if (x2 >= nX || y2 >= nY)  // unsigned, so this also catches -1
+					continue;
+				const Index bit = 4 * v + d;
+				if (removed && ((removed[bit / 32] >> (bit % 32)) & 1))
+					closed.push_back(m);
+				addArc(tail, x2 + y2 * nX + 1, 1);
+			}
+		}
+
+		for (Index i = 0; i < count; i++)
+			addArc(tail, n, 0);
+	}
+	outFirst[N] = m;
+
+	// arcs leaving the super source
+	for (Index i = 0; i < nSources; i++)
+		addArc(n - 1, sources[i] + 1, 0);
+
+	Dfct[n - 2] = - FNumber(nSources);
+	Dfct[n - 1] = FNumber(nSources);
+}
+
+bool RoutingNetwork::SameTopology(const RoutingNetwork &other) const
+{
+	return nX == other.nX && nY == other.nY && nodeCount == other.nodeCount &&
+		extraFirst == other.extraFirst && extraHeads == other.extraHeads &&
+		sources == other.sources && targets == other.targets;
+}
@@ -0,0 +1,82 @@
+// RoutingNetwork.h
+
+#pragma once
+
+#include <vector>
+
+#include "MCFClass.h"
+
+// The split-node min cost flow network of a routing grid, built directly
+// in the arrays taken by MCFClass::LoadNet.
+//
+// The routing grid has nX * nY manhattan grid nodes, numbered x + y * nX,
+// followed by extra nodes (e.g. punches and control lines), which are only
+// connected through extra edges; N is the total number of nodes. Each node
+// v is split into an incoming vertex v + 1 and an outgoing vertex N + v + 1,
+// joined by an arc of capacity 1 and cost 0, so that a node is used by at
+// most one connection. Each edge (v, w) becomes an arc of capacity 1 and
+// cost 1 from the outgoing vertex of v to the incoming vertex of w. The
+// super source 2N + 1 feeds the incoming vertices of the sources, and the
+// outgoing vertices of the targets drain into the super sink 2N + 2.
+//
+// The arcs are in forward-star order, i.e. sorted by tail vertex: first
+// the N node arcs, then the arcs leaving the outgoing vertex of each node
+// (its extra edges, its grid edges towards +x, +y, -x and -y, and its arc
+// to the super sink if it is a target), then the arcs leaving the super
+// source. Removed grid edges keep their arc, so that the numbering only
+// depends on the topology, and are listed as closed arcs instead.
+class RoutingNetwork
+{
+public:
+	RoutingNetwork();
+
+	// extraFirst[v] .. extraFirst[v + 1] - 1 index the heads of the extra
+	// edges of node v in extraHeads (extraFirst has N + 1 entries, and may
+	// be NULL if there are no extra edges); bit 4 * v + d of the removed
+	// bitset (32 bits per word, least significant first, may be NULL) tells
+	// whether the grid edge of node v in direction d (+x, +y, -x, -y) is
+	// removed.
+	void Build(Index pnX, Index pnY, Index nExtra, const Index extraFirst[], const Index extraHeads[], const unsigned int removed[], const Index sources[], Index nSources, const Index targets[], Index nTargets);
+
+	// whether both networks have the same nodes, edges, sources and targets,
+	// hence the same arcs, and only differ in their closed arcs
+	bool SameTopology(const RoutingNetwork &other) const;
+
+	Index VertexCount() const { return n; }
+	Index ArcCount() const { return m; }
+	Index NodeCount() const { return nodeCount; }
+
+	const FNumber *Capacities() const { return data(U); }
+	const CNumber *Costs() const { return data(C); }
+	const FNumber *Deficits() const { return data(Dfct); }
+	const Index *StartNodes() const { return data(Sn); }
+	const Index *EndNodes() const { return data(En); }
+
+	// the arcs of removed grid edges, in increasing order
+	Index ClosedArcCount() const { return Index(closed.size()); }
+	const Index *ClosedArcs() const { return data(closed); }
+
+	// the arcs leaving the outgoing vertex of node v are
+	// FirstArc(v) .. FirstArc(v + 1) - 1
+	Index FirstArc(Index v) const { return outFirst[v]; }
+
+	// the node entered by an arc leaving an outgoing vertex,
+	// or InINF for the arcs to the super sink
+	Index ArcHeadNode(Index arc) const { return En[arc] == n ? InINF : En[arc] - 1; }
+
+private:
+	template<class T>
+	static const T *data(const std::vector<T> &v) { return v.empty() ? 0 : &v[0]; }
+
+	void addArc(Index tail, Index head, CNumber cost);
+
+	// topology
+	Index nX, nY, nodeCount;
+	std::vector<Index> extraFirst, extraHeads, sources, targets;
+
+	// network
+	Index n, m;
+	std::vector<FNumber> U, Dfct;
+	std::vector<CNumber> C;
+	std::vector<Index> Sn, En, closed, outFirst;
+};
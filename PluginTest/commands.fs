@@ -11,6 +11,8 @@ open BioStream.Micado.Plugin
 
 open BioStream.Micado.Plugin.Editor.Extra
 
+open MgCS2
+
 [<CommandMethod("micadotest_polyline2flow")>]
 /// tests converting a polyline to a flow line
 let test_polyline2flow() =
@@ -237,3 +239,398 @@ let verify_control_line_number (controlLayer : Datatypes.Control) =
 let test_verify_control_line_number() =
     use chip = Chip.FromDatabase.create()
     verify_control_line_number chip.ControlLayer
+
+/// builds the min-cost-flow network of an nX by nY routing grid,
+/// split into incoming and outgoing vertices as in Routing.minCostFlowRouting,
+/// with the left column as sources and the right column as targets
+let gridNetwork nX nY =
+    let nodeCount = nX*nY
+    let incoming node = uint32(node + 1)
+    let outgoing node = uint32(nodeCount + node + 1)
+    let superSource = uint32(2*nodeCount + 1)
+    let superTarget = uint32(2*nodeCount + 2)
+    let edge2source = new ResizeArray<uint32>()
+    let edge2target = new ResizeArray<uint32>()
+    let edge2capacity = new ResizeArray<float>()
+    let edge2cost = new ResizeArray<float>()
+    let addEdge source target capacity cost =
+        edge2source.Add(source)
+        edge2target.Add(target)
+        edge2capacity.Add(capacity)
+        edge2cost.Add(cost)
+    for node in 0..nodeCount-1 do
+        let x, y = node % nX, node / nX
+        for (x', y') in [(x+1,y); (x-1,y); (x,y+1); (x,y-1)] do
+            if 0 <= x' && x' < nX && 0 <= y' && y' < nY
+            then addEdge (outgoing node) (incoming (x'+y'*nX)) 1.0 1.0
+        addEdge (incoming node) (outgoing node) 1.0 0.0
+    for y in 0..nY-1 do
+        addEdge superSource (incoming (y*nX)) 1.0 0.0
+        addEdge (outgoing (y*nX+nX-1)) superTarget 1.0 0.0
+    let vertex2deficit = Array.create (2*nodeCount + 2) 0.0
+    vertex2deficit.[2*nodeCount] <- - float(nY)
+    vertex2deficit.[2*nodeCount+1] <- float(nY)
+    (uint32(2*nodeCount + 2), uint32(edge2source.Count),
+     edge2capacity.ToArray(), edge2cost.ToArray(), vertex2deficit,
+     edge2source.ToArray(), edge2target.ToArray())
+
+[<CommandMethod("micadotest_mcf_load_benchmark")>]
+/// benchmark loading a routing-sized network into the min cost flow solver:
+/// the old path, which copied every array once more before loading,
+/// against the pinned arrays handed straight to the solver
+let test_mcf_load_benchmark() =
+    let rounds = 5
+    let watch = new System.Diagnostics.Stopwatch()
+    let bestOf load =
+        let mutable best = System.Int64.MaxValue
+        for round in 1..rounds do
+            watch.Reset()
+            watch.Start()
+            use solver = load ()
+            watch.Stop()
+            best <- min best watch.ElapsedMilliseconds
+        best
+    for side in [100; 300; 450] do
+        let n, m, capacities, costs, deficits, sources, targets = gridNetwork side side
+        let copied =
+            bestOf (fun () -> new MgMCFSolver(n, m, Array.copy capacities, Array.copy costs, Array.copy deficits,
+                                              Array.copy sources, Array.copy targets))
+        let pinned =
+            bestOf (fun () -> new MgMCFSolver(n, m, capacities, costs, deficits, sources, targets))
+        use solver = new MgMCFSolver(n, m, capacities, costs, deficits, sources, targets)
+        watch.Reset()
+        watch.Start()
+        solver.SolveMCF()
+        watch.Stop()
+        Editor.writeLine (sprintf "%d vertices, %d edges: load %d ms copied, %d ms pinned (best of %d), solve %d ms"
+                                  n m copied pinned rounds watch.ElapsedMilliseconds)
+
+[<CommandMethod("micadotest_mcf_reload_benchmark")>]
+/// benchmark repeated routing-sized solves: a fresh solver per attempt
+/// against a single solver reloaded in place
+let test_mcf_reload_benchmark() =
+    let rounds = 10
+    let n, m, capacities, costs, deficits, sources, targets = gridNetwork 300 300
+    let watch = System.Diagnostics.Stopwatch.StartNew()
+    for round in 1..rounds do
+        use solver = new MgMCFSolver(n, m, capacities, costs, deficits, sources, targets)
+        solver.SolveMCF()
+    let fresh = watch.ElapsedMilliseconds
+    watch.Reset()
+    watch.Start()
+    use solver = new MgMCFSolver()
+    for round in 1..rounds do
+        solver.Reload(n, m, capacities, costs, deficits, sources, targets)
+        solver.SolveMCF()
+    let reloaded = watch.ElapsedMilliseconds
+    Editor.writeLine (sprintf "%d vertices, %d edges, %d rounds: fresh solvers %d ms, reloaded solver %d ms"
+                              n m rounds fresh reloaded)
+
+[<CommandMethod("micadotest_mcf_warm_start_benchmark")>]
+/// benchmark blocking grid cells one at a time:
+/// warm-started re-solves against cold reload-and-solve
+let test_mcf_warm_start_benchmark() =
+    let side = 300
+    let rounds = 10
+    let n, m, capacities, costs, deficits, sources, targets = gridNetwork side side
+    let cellArc cell =
+        let incoming, outgoing = uint32(cell + 1), uint32(side*side + cell + 1)
+        let rec find arc =
+            if sources.[arc] = incoming && targets.[arc] = outgoing then arc else find (arc+1)
+        find 0
+    let random = new System.Random(0)
+    let blocked = [| for round in 1..rounds -> cellArc (random.Next(side*side)) |]
+    use warm = new MgMCFSolver(n, m, capacities, costs, deficits, sources, targets)
+    warm.SolveMCF()
+    use cold = new MgMCFSolver()
+    let capacities = Array.copy capacities
+    let watch = new System.Diagnostics.Stopwatch()
+    let mutable warmTime = 0L
+    let mutable coldTime = 0L
+    for arc in blocked do
+        watch.Reset()
+        watch.Start()
+        warm.ChangeCapacities([|arc|], [|0.0|])
+        warm.SolveMCF()
+        watch.Stop()
+        warmTime <- warmTime + watch.ElapsedMilliseconds
+        capacities.[arc] <- 0.0
+        watch.Reset()
+        watch.Start()
+        cold.Reload(n, m, capacities, costs, deficits, sources, targets)
+        cold.SolveMCF()
+        watch.Stop()
+        coldTime <- coldTime + watch.ElapsedMilliseconds
+    Editor.writeLine (sprintf "%d blocked cells on a %dx%d grid: warm %d ms, cold %d ms"
+                              rounds side side warmTime coldTime)
+
+[<CommandMethod("micadotest_routing_network_benchmark")>]
+/// benchmark building the routing network of a grid:
+/// managed arrays built in F# against the native builder
+let test_routing_network_benchmark() =
+    let side = 450
+    let rounds = 5
+    let sources = [| for y in 0..side-1 -> y*side |]
+    let targets = [| for y in 0..side-1 -> y*side+side-1 |]
+    let watch = new System.Diagnostics.Stopwatch()
+    let mutable managed = System.Int64.MaxValue
+    for round in 1..rounds do
+        watch.Reset()
+        watch.Start()
+        gridNetwork side side |> ignore
+        watch.Stop()
+        managed <- min managed watch.ElapsedMilliseconds
+    use network = new MgRoutingNetwork()
+    let mutable native = System.Int64.MaxValue
+    for round in 1..rounds do
+        watch.Reset()
+        watch.Start()
+        network.Build(side, side, 0, null, null, null, sources, targets)
+        watch.Stop()
+        native <- min native watch.ElapsedMilliseconds
+    Editor.writeLine (sprintf "%d vertices, %d edges: managed build %d ms, native build %d ms (best of %d)"
+                              network.VertexCount network.ArcCount managed native rounds)
+
+/// builds a random transportation network with n nodes and m random edges,
+/// with costs below 10000 and some pairs of supply and demand nodes,
+/// made feasible by a ring of expensive edges through all the nodes;
+/// unlike routing grids, it takes the solver through several scaling phases
+let randomNetwork n m seed =
+    let random = new System.Random(seed)
+    let edge2source = new ResizeArray<uint32>()
+    let edge2target = new ResizeArray<uint32>()
+    let edge2capacity = new ResizeArray<float>()
+    let edge2cost = new ResizeArray<float>()
+    let addEdge source target capacity cost =
+        edge2source.Add(uint32(source))
+        edge2target.Add(uint32(target))
+        edge2capacity.Add(capacity)
+        edge2cost.Add(cost)
+    for edge in 1..m do
+        let source = random.Next(n) + 1
+        let target = (source + random.Next(n-1)) % n + 1
+        addEdge source target (float(random.Next(1, 21))) (float(random.Next(10000)))
+    for vertex in 1..n do
+        addEdge vertex (vertex % n + 1) 1000.0 20000.0
+    let vertex2deficit = Array.create n 0.0
+    for pair in 1..n/5 do
+        let supply = float(random.Next(10))
+        let source, target = random.Next(n), random.Next(n)
+        vertex2deficit.[source] <- vertex2deficit.[source] - supply
+        vertex2deficit.[target] <- vertex2deficit.[target] + supply
+    (uint32(n), uint32(edge2source.Count),
+     edge2capacity.ToArray(), edge2cost.ToArray(), vertex2deficit,
+     edge2source.ToArray(), edge2target.ToArray())
+
+/// the cost of the flow found by the solver
+let flowCost ( solver : MgMCFSolver ) ( costs : float array ) =
+    let flows = Array.zero_create costs.Length : float array
+    solver.MCFGetX(flows)
+    let mutable cost = 0.0
+    for arc in 0..costs.Length-1 do
+        cost <- cost + flows.[arc] * costs.[arc]
+    cost
+
+[<CommandMethod("micadotest_mcf_price_out")>]
+/// regression test of price out and price in, which the solver only uses from phase
+/// PriceOutStart on, in the arc layout of MgCS2.vcproj (CS2_SOA_ARCS and CS2_INDEX_LINKS):
+/// a random network and a routing grid are solved with small values of PriceOutStart,
+/// with the default scale factor and with 2 (twice as many phases),
+/// by the integer and the floating point solvers;
+/// each solve must find the objective of a solve that never prices out, and on the
+/// random network run at least PriceOutStart phases (the grid is solved in one phase,
+/// in which price in is still reached with PriceOutStart 1)
+let test_mcf_price_out() =
+    let mutable failures = 0
+    for (name, network) in [("random", randomNetwork 2000 12000 0); ("grid", gridNetwork 30 30)] do
+        let n, m, capacities, costs, deficits, sources, targets = network
+        let solve numbers priceOutStart scaleFactor =
+            use solver = new MgMCFSolver(numbers)
+            let mutable parameters = MgCS2Params.Default
+            parameters.PriceOutStart <- priceOutStart
+            parameters.ScaleFactor <- scaleFactor
+            solver.Params <- parameters
+            solver.Reload(n, m, capacities, costs, deficits, sources, targets)
+            solver.SolveMCF()
+            if solver.HasSolution()
+            then Some (flowCost solver costs, solver.GetStatistics().NRefine)
+            else None
+        let defaultScaleFactor = MgCS2Params.Default.ScaleFactor
+        let expected = solve MgMCFNumbers.Double 1000 defaultScaleFactor |> Option.map fst
+        for numbers in [MgMCFNumbers.Int32; MgMCFNumbers.Double] do
+            for scaleFactor in [defaultScaleFactor; 2] do
+                for priceOutStart in [1; 2; 5] do
+                    let result = solve numbers priceOutStart scaleFactor
+                    let passed =
+                        match expected, result with
+                        | Some objective, Some (objective', phases) ->
+                            objective' = objective
+                            && (name = "grid" || phases >= int64(priceOutStart))
+                        | _ -> false
+                    if not passed
+                    then failures <- failures + 1
+                         Editor.writeLine (sprintf "FAILED: %s network, %A, PriceOutStart %d, ScaleFactor %d: %A (expected %A)"
+                                                   name numbers priceOutStart scaleFactor result expected)
+    Editor.writeLine (sprintf "price out test: %d failures" failures)
+
+[<CommandMethod("micadotest_mcf_warm_start")>]
+/// regression test of warm starts: small random networks are changed one deficit pair,
+/// cost or capacity at a time, and each warm-started re-solve must agree with a cold
+/// solve of the changed network on feasibility and on the cost of the flow; capacities
+/// may drop to 0, so that some changes make the network unfeasible and the next ones
+/// restart from the flow that was left
+let test_mcf_warm_start() =
+    let mutable failures = 0
+    let mutable edits = 0
+    for seed in 0..199 do
+        for numbers in [MgMCFNumbers.Int32; MgMCFNumbers.Double] do
+            let random = new System.Random(seed)
+            let n, m, capacities, costs, deficits, sources, targets =
+                randomNetwork (random.Next(2, 40)) (random.Next(1, 120)) seed
+            use warm = new MgMCFSolver(numbers)
+            warm.Reload(n, m, capacities, costs, deficits, sources, targets)
+            warm.SolveMCF()
+            use cold = new MgMCFSolver(numbers)
+            for edit in 1..30 do
+                match random.Next(3) with
+                | 0 -> let source, target = random.Next(int n), random.Next(int n)
+                       let supply = float(random.Next(30))
+                       deficits.[source] <- deficits.[source] - supply
+                       deficits.[target] <- deficits.[target] + supply
+                       warm.ChangeDeficits([|source; target|], [|deficits.[source]; deficits.[target]|])
+                | 1 -> let arc = random.Next(int m)
+                       costs.[arc] <- float(random.Next(10000))
+                       warm.ChangeCosts([|arc|], [|costs.[arc]|])
+                | _ -> let arc = random.Next(int m)
+                       capacities.[arc] <- float(random.Next(21))
+                       warm.ChangeCapacities([|arc|], [|capacities.[arc]|])
+                warm.SolveMCF()
+                cold.Reload(n, m, capacities, costs, deficits, sources, targets)
+                cold.SolveMCF()
+                edits <- edits + 1
+                let result (solver : MgMCFSolver) =
+                    if solver.HasSolution() then Some (flowCost solver costs) else None
+                if result warm <> result cold
+                then failures <- failures + 1
+                     Editor.writeLine (sprintf "FAILED: seed %d, %A, edit %d: warm %A, cold %A"
+                                               seed numbers edit (result warm) (result cold))
+    Editor.writeLine (sprintf "warm start test: %d edits, %d failures" edits failures)
+
+[<CommandMethod("micadotest_mcf_put_state")>]
+/// regression test of PutState after a change of the network: the capacity of an arc
+/// carrying flow is cut to 0 between GetState and PutState, so the saved flow is no
+/// longer a solution and the solver must not report one until it is solved again;
+/// the re-solve must then agree with a cold solve of the changed network
+let test_mcf_put_state() =
+    let mutable failures = 0
+    let mutable puts = 0
+    for seed in 0..199 do
+        for numbers in [MgMCFNumbers.Int32; MgMCFNumbers.Double] do
+            let random = new System.Random(seed)
+            let n, m, capacities, costs, deficits, sources, targets =
+                randomNetwork (random.Next(2, 40)) (random.Next(1, 120)) seed
+            use solver = new MgMCFSolver(numbers)
+            solver.Reload(n, m, capacities, costs, deficits, sources, targets)
+            solver.SolveMCF()
+            let flows = Array.zero_create (int m) : float array
+            solver.MCFGetX(flows)
+            let loaded = [| for arc in 0..int(m)-1 do if flows.[arc] > 0.0 then yield arc |]
+            if solver.HasSolution() && loaded.Length > 0
+            then use state = solver.GetState()
+                 let arc = loaded.[random.Next(loaded.Length)]
+                 capacities.[arc] <- 0.0
+                 solver.ChangeCapacities([|arc|], [|0.0|])
+                 solver.PutState(state)
+                 puts <- puts + 1
+                 if solver.HasSolution()
+                 then failures <- failures + 1
+                      Editor.writeLine (sprintf "FAILED: seed %d, %A: solution reported after PutState"
+                                                seed numbers)
+                 solver.SolveMCF()
+                 use cold = new MgMCFSolver(numbers)
+                 cold.Reload(n, m, capacities, costs, deficits, sources, targets)
+                 cold.SolveMCF()
+                 let result (solver : MgMCFSolver) =
+                     if solver.HasSolution() then Some (flowCost solver costs) else None
+                 if result solver <> result cold
+                 then failures <- failures + 1
+                      Editor.writeLine (sprintf "FAILED: seed %d, %A: re-solve %A, cold %A"
+                                                seed numbers (result solver) (result cold))
+    Editor.writeLine (sprintf "put state test: %d puts, %d failures" puts failures)
+
+[<CommandMethod("micadotest_mcf_rip_up_bound")>]
+/// regression test of EstimateRipUpCost: one to three arcs carrying flow are removed
+/// from small random networks, and the estimate must not exceed the growth of the
+/// optimal cost found by solving the network without them
+let test_mcf_rip_up_bound() =
+    let mutable failures = 0
+    let mutable checks = 0
+    for seed in 0..199 do
+        for numbers in [MgMCFNumbers.Int32; MgMCFNumbers.Double] do
+            let random = new System.Random(seed)
+            let n, m, capacities, costs, deficits, sources, targets =
+                randomNetwork (random.Next(2, 40)) (random.Next(1, 120)) seed
+            use solver = new MgMCFSolver(numbers)
+            solver.Reload(n, m, capacities, costs, deficits, sources, targets)
+            solver.SolveMCF()
+            let flows = Array.zero_create (int m) : float array
+            solver.MCFGetX(flows)
+            let loaded = [| for arc in 0..int(m)-1 do if flows.[arc] > 0.0 then yield arc |]
+            if solver.HasSolution() && loaded.Length > 0
+            then let picked = Array.init (random.Next(1, 4)) (fun _ -> loaded.[random.Next(loaded.Length)])
+                 let removed = picked |> Set.of_array |> Set.to_array
+                 let estimate = solver.EstimateRipUpCost(removed)
+                 let before = flowCost solver costs
+                 let capacities = Array.copy capacities
+                 for arc in removed do
+                     capacities.[arc] <- 0.0
+                 use after = new MgMCFSolver(numbers)
+                 after.Reload(n, m, capacities, costs, deficits, sources, targets)
+                 after.SolveMCF()
+                 if after.HasSolution()
+                 then checks <- checks + 1
+                      let growth = flowCost after costs - before
+                      if estimate > growth + 1e-6
+                      then failures <- failures + 1
+                           Editor.writeLine (sprintf "FAILED: seed %d, %A: estimate %g, growth %g"
+                                                     seed numbers estimate growth)
+    Editor.writeLine (sprintf "rip up bound test: %d checks, %d failures" checks failures)
+
+/// writes a network in the DIMACS min cost flow format, as read by MgCS2Tuner
+let writeDimacs (path : string)
+                ( network : uint32 * uint32 * float array * float array * float array * uint32 array * uint32 array ) =
+    let n, m, capacities, costs, deficits, sources, targets = network
+    use writer = new System.IO.StreamWriter(path)
+    writer.WriteLine(sprintf "p min %d %d" n m)
+    for node in 0..int(n)-1 do
+        if deficits.[node] <> 0.0
+        then writer.WriteLine(sprintf "n %d %g" (node+1) (- deficits.[node]))
+    for arc in 0..int(m)-1 do
+        writer.WriteLine(sprintf "a %d %d 0 %g %g" sources.[arc] targets.[arc] capacities.[arc] costs.[arc])
+
+[<CommandMethod("micadotest_mcf_tuner")>]
+/// smoke test of MgCS2Tuner in the arc layout of MgCS2.vcproj (CS2_SOA_ARCS and
+/// CS2_INDEX_LINKS): a family of random networks and one of routing grids are written
+/// to temporary directories and tuned with the integer solver; the sweep of PriceOutStart
+/// takes every instance through price in, and Tune must report on both families
+let test_mcf_tuner() =
+    let root = System.IO.Path.Combine(System.IO.Path.GetTempPath(), "micadotest_mcf_tuner")
+    let families =
+        [("random", [| randomNetwork 2000 12000 0; randomNetwork 2000 12000 1 |]);
+         ("grid", [| gridNetwork 30 30; gridNetwork 40 20 |])]
+    let files =
+        [| for (family, networks) in families do
+               let directory = System.IO.Path.Combine(root, family)
+               System.IO.Directory.CreateDirectory(directory) |> ignore
+               for k in 0..networks.Length-1 do
+                   let file = System.IO.Path.Combine(directory, sprintf "%d.dmx" k)
+                   writeDimacs file networks.[k]
+                   yield file |]
+    try
+        let report = MgCS2Tuner.Tune(files, MgMCFNumbers.Int32, 1)
+        Editor.writeLine report
+        let lines = report.Split([|'\n'|], System.StringSplitOptions.RemoveEmptyEntries)
+        Editor.writeLine (sprintf "tuner test: %s"
+                                  (if lines.Length = List.length families then "passed" else "FAILED"))
+    finally
+        System.IO.Directory.Delete(root, true)